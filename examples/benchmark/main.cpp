@@ -0,0 +1,671 @@
+#include <rapidjson/istreamwrapper.h>
+#include <rapidjson/ostreamwrapper.h>
+#include <reflection/archive_view.h>
+#include <reflection/record_stream.h>
+#include <reflection/serialization.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <iostream>
+#include <list>
+#include <map>
+#include <memory_resource>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using reflection::ISerialization;
+
+using reflection::Deserialize;
+using reflection::Serialize;
+
+// Field tables as they were built before offsets: a map from name to an accessor
+// that checks the guard of a static Userdata and computes the member address on every call
+namespace legacy {
+
+template <class I>
+struct FieldInfo {
+    void* address;
+    const reflection::IType<I>* type;
+    const reflection::UserdataBase* userdata;
+};
+
+template <class I>
+using FieldTable = std::map<std::string, FieldInfo<I> (*)(I*)>;
+
+}  // namespace legacy
+
+#define LEGACY_FIELD_DECLARATION_BEGIN(interfacename)                              \
+    virtual const legacy::FieldTable<interfacename>& GetLegacyFieldTable() const { \
+        using Class = std::decay_t<decltype(*this)>;                               \
+        using InterfaceType = interfacename;                                       \
+        static const legacy::FieldTable<InterfaceType> m {
+#define LEGACY_FIELD_DECLARATION(name, field, ...) \
+    {name, [](InterfaceType* arg) {                                    \
+        auto p = static_cast<Class*>(arg);                             \
+        using T = decltype(p->field);                                  \
+        static typename reflection::Type<InterfaceType, T>::Userdata d; \
+        __VA_ARGS__;                                                   \
+        return legacy::FieldInfo<InterfaceType> {                      \
+            static_cast<void*>(&(p->field)),                           \
+            reflection::Type<InterfaceType, T>::GetIType(),            \
+            static_cast<reflection::UserdataBase*>(&d) }; }},
+
+#define LEGACY_FIELD_DECLARATION_END() \
+    }                                  \
+    ;                                  \
+    return m;                          \
+    }
+
+enum class Enum {
+    E1,
+    E2
+};
+
+using Pair = std::pair<int, float[2]>;
+
+STRUCT_FIELD_DECLARATION_BEGIN(Pair, ISerialization)
+STRUCT_FIELD_DECLARATION("first", first)
+STRUCT_FIELD_DECLARATION("second", second)
+STRUCT_FIELD_DECLARATION_END()
+
+// Same shape as Test in examples/example, without the types that need glm or subclasses
+#define TEST_FIELDS(DECLARE)        \
+    DECLARE("e", e)                 \
+    DECLARE("i", i)                 \
+    DECLARE("b", b)                 \
+    DECLARE("s", s)                 \
+    DECLARE("f", f)                 \
+    DECLARE("d", inner.d)           \
+    DECLARE("li", li)               \
+    DECLARE("map", map)             \
+    DECLARE("umap", umap)           \
+    DECLARE("uf", uf)               \
+    DECLARE("vecf", vecf)           \
+    DECLARE("mat1x2x3", mat1x2x3)   \
+    DECLARE("pnext", pnext)         \
+    DECLARE("pair", pair)
+
+class Test : public ISerialization {
+public:
+    Enum e{};
+    int i{};
+    float f{};
+    bool b{};
+    std::string s;
+    struct Inner {
+        double d{};
+    };
+    Inner inner{};
+    std::list<float> li;
+    std::map<std::string, int> map;
+    std::unordered_map<std::string, std::unique_ptr<int>> umap;
+    std::unique_ptr<float> uf{};
+    std::vector<float> vecf;
+    std::array<float[3], 2> mat1x2x3[1]{};
+    std::unique_ptr<Test> pnext;
+    Pair pair;
+
+    FIELD_DECLARATION_BEGIN(ISerialization)
+    TEST_FIELDS(FIELD_DECLARATION)
+    FIELD_DECLARATION_END()
+
+    LEGACY_FIELD_DECLARATION_BEGIN(ISerialization)
+    TEST_FIELDS(LEGACY_FIELD_DECLARATION)
+    LEGACY_FIELD_DECLARATION_END()
+};
+
+struct Particle {
+    float x{};
+    float y{};
+    float vx{};
+    float vy{};
+    std::string tag;
+    int flags{};
+};
+
+STRUCT_FIELD_DECLARATION_BEGIN(Particle, ISerialization)
+STRUCT_FIELD_DECLARATION("x", x)
+STRUCT_FIELD_DECLARATION("y", y)
+STRUCT_FIELD_DECLARATION("vx", vx)
+STRUCT_FIELD_DECLARATION("vy", vy)
+STRUCT_FIELD_DECLARATION("tag", tag)
+STRUCT_FIELD_DECLARATION("flags", flags)
+STRUCT_FIELD_DECLARATION_END()
+
+// Trivially copyable, written as memory images in raw mode
+struct Sample {
+    float position[3]{};
+    float weight{};
+    int id{};
+};
+
+STRUCT_FIELD_DECLARATION_BEGIN(Sample, ISerialization)
+STRUCT_FIELD_DECLARATION("position", position)
+STRUCT_FIELD_DECLARATION("weight", weight)
+STRUCT_FIELD_DECLARATION("id", id)
+STRUCT_FIELD_DECLARATION_END()
+
+class Shape : public ISerialization {
+public:
+    virtual ~Shape(){};
+
+    int id{};
+
+    FIELD_DECLARATION_BEGIN(ISerialization)
+    FIELD_DECLARATION("id", id)
+    FIELD_DECLARATION_END()
+};
+
+HAS_SUBCLASS(Shape)
+
+class Circle : public Shape {
+public:
+    float r{};
+
+    FIELD_DECLARATION_BEGIN(ISerialization)
+    FIELD_DECLARATION("r", r)
+    FIELD_DECLARATION_END_WITH_BASE_CLASS(Shape)
+};
+
+SUBCLASS_DECLARATION_BEGIN(Shape)
+SUBCLASS_DECLARATION(Circle)
+SUBCLASS_DECLARATION_END()
+
+class Scene : public ISerialization {
+public:
+    std::vector<std::unique_ptr<Shape, reflection::ResourceDeleter>> shapes;
+
+    FIELD_DECLARATION_BEGIN(ISerialization)
+    FIELD_DECLARATION("shapes", shapes)
+    FIELD_DECLARATION_END()
+};
+
+// Catalog entries with strings owned or referenced in the source buffer
+template <class String>
+struct CatalogEntry {
+    String name;
+    String category;
+    int count{};
+};
+
+STRUCT_FIELD_DECLARATION_BEGIN(CatalogEntry<std::string>, ISerialization)
+STRUCT_FIELD_DECLARATION("name", name)
+STRUCT_FIELD_DECLARATION("category", category)
+STRUCT_FIELD_DECLARATION("count", count)
+STRUCT_FIELD_DECLARATION_END()
+
+STRUCT_FIELD_DECLARATION_BEGIN(CatalogEntry<std::string_view>, ISerialization)
+STRUCT_FIELD_DECLARATION("name", name)
+STRUCT_FIELD_DECLARATION("category", category)
+STRUCT_FIELD_DECLARATION("count", count)
+STRUCT_FIELD_DECLARATION_END()
+
+// Input stream without direct access to its characters, read one token at a time
+struct TokenStream {
+    using Ch = char;
+
+    explicit TokenStream(const char* s) : stream(s) {
+    }
+
+    Ch Peek() const {
+        return stream.Peek();
+    }
+
+    Ch Take() {
+        return stream.Take();
+    }
+
+    size_t Tell() const {
+        return stream.Tell();
+    }
+
+    rapidjson::StringStream stream;
+};
+
+template <class F>
+double MeasureNanoseconds(size_t iterations, F&& f) {
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i)
+        f();
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+int main() {
+    constexpr size_t kIterations = 1000000;
+
+    Test test;
+    test.s = "string";
+    test.li = {0.125f, 0.25f};
+    test.map = {{"key", 9}, {"new key", 999}};
+    test.umap["ukey"] = std::make_unique<int>(9);
+    test.uf = std::make_unique<float>(999.5f);
+    test.vecf = {0.5f, 1.5f, 2.5f};
+    const ISerialization& object = test;
+    const size_t field_count = reflection::GetFieldTable<ISerialization>(object).size();
+
+    // Resolve address, IType and Userdata of every field, as Serialize and Deserialize do
+    volatile uintptr_t sink = 0;
+    const auto legacy_ns = MeasureNanoseconds(kIterations, [&] {
+        uintptr_t acc = 0;
+        for (const auto& [name, get] : test.GetLegacyFieldTable()) {
+            auto info = get(const_cast<ISerialization*>(&object));
+            acc += reinterpret_cast<uintptr_t>(info.address) ^ reinterpret_cast<uintptr_t>(info.type) ^ reinterpret_cast<uintptr_t>(info.userdata);
+        }
+        sink = sink + acc;
+    });
+    const auto offset_ns = MeasureNanoseconds(kIterations, [&] {
+        uintptr_t acc = 0;
+        const auto table = reflection::GetFieldTable<ISerialization>(object);
+        for (const auto& field : table) {
+            acc += reinterpret_cast<uintptr_t>(table.GetAddress(field)) ^ reinterpret_cast<uintptr_t>(field.type) ^ reinterpret_cast<uintptr_t>(field.userdata);
+        }
+        sink = sink + acc;
+    });
+    const auto static_ns = MeasureNanoseconds(kIterations, [&] {
+        uintptr_t acc = 0;
+        reflection::for_each_field<ISerialization>(test, [&acc](std::string_view, const auto& member) {
+            acc += reinterpret_cast<uintptr_t>(&member);
+        });
+        sink = sink + acc;
+    });
+
+    std::cout << "fields per object: " << field_count << "\n";
+    std::cout << "legacy map + accessor: " << legacy_ns / (kIterations * field_count) << " ns/field\n";
+    std::cout << "offset table:          " << offset_ns / (kIterations * field_count) << " ns/field\n";
+    std::cout << "for_each_field:        " << static_ns / (kIterations * field_count) << " ns/field\n";
+
+    // Get a value by name, walking field tables with string lookups vs a compiled property path
+    const auto walk_ns = MeasureNanoseconds(kIterations, [&] {
+        const auto table = reflection::GetFieldTable<ISerialization>(test);
+        const auto pair = table.Find("pair");
+        const auto& second = static_cast<const Pair*>(table.GetAddress(*pair))->second;
+        sink = sink + static_cast<uintptr_t>(second[1]);
+    });
+    const auto path = reflection::CompilePropertyPath<ISerialization, Test>("pair.second[1]");
+    const auto path_ns = MeasureNanoseconds(kIterations, [&] {
+        sink = sink + static_cast<uintptr_t>(*path.Get<float>(test));
+    });
+
+    std::cout << "Get by table lookup:   " << walk_ns / kIterations << " ns\n";
+    std::cout << "Get by property path:  " << path_ns / kIterations << " ns\n";
+
+    // Move every particle along x: AoS reads whole elements, SoA only the two columns used
+    constexpr size_t kParticles = 100000;
+    constexpr size_t kSteps = 200;
+    std::vector<Particle> aos(kParticles);
+    reflection::SoaVector<ISerialization, Particle> soa;
+    soa.resize(kParticles);
+    using Particles = decltype(soa);
+    const auto aos_ns = MeasureNanoseconds(kSteps, [&] {
+        for (auto& p : aos)
+            p.x += p.vx;
+    });
+    const auto soa_ns = MeasureNanoseconds(kSteps, [&] {
+        const auto x = soa.Column<Particles::ColumnIndex("x")>();
+        const auto vx = soa.Column<Particles::ColumnIndex("vx")>();
+        for (size_t i = 0; i < soa.size(); ++i)
+            x[i] += vx[i];
+    });
+
+    std::cout << "Scan std::vector<Particle>: " << aos_ns / (kSteps * kParticles) << " ns/element\n";
+    std::cout << "Scan SoaVector<Particle>:   " << soa_ns / (kSteps * kParticles) << " ns/element\n";
+
+    constexpr size_t kRoundTrips = 20000;
+    std::string json;
+    const auto serialize_ns = MeasureNanoseconds(kRoundTrips, [&] {
+        rapidjson::StringBuffer buffer;
+        rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
+        Serialize(test, writer);
+        json = buffer.GetString();
+    });
+    std::string compact_json;
+    const auto compact_ns = MeasureNanoseconds(kRoundTrips, [&] {
+        rapidjson::StringBuffer buffer;
+        Serialize(test, buffer, reflection::SerializeMode::Compact);
+        compact_json = buffer.GetString();
+    });
+    rapidjson::Document document;
+    document.Parse(json.c_str());
+    Test loaded;
+    const auto deserialize_ns = MeasureNanoseconds(kRoundTrips, [&] {
+        Deserialize(loaded, document);
+    });
+
+    std::cout << "Serialize:   " << serialize_ns / kRoundTrips << " ns/object, " << json.size() << " bytes\n";
+    std::cout << "Compact:     " << compact_ns / kRoundTrips << " ns/object, " << compact_json.size() << " bytes\n";
+    std::cout << "Deserialize: " << deserialize_ns / kRoundTrips << " ns/object\n";
+
+    // Round trip check: compare documents vs compare objects
+    rapidjson::Document document_new;
+    const auto document_equal_ns = MeasureNanoseconds(kRoundTrips, [&] {
+        rapidjson::StringBuffer buffer;
+        rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
+        Serialize(loaded, writer);
+        document_new.Parse(buffer.GetString());
+        sink = sink + (document == document_new);
+    });
+    const auto equal_ns = MeasureNanoseconds(kRoundTrips, [&] {
+        sink = sink + reflection::Equal<ISerialization>(test, loaded);
+    });
+    const auto hash_ns = MeasureNanoseconds(kRoundTrips, [&] {
+        sink = sink + reflection::Hash<ISerialization>(loaded);
+    });
+
+    std::cout << "Document ==: " << document_equal_ns / kRoundTrips << " ns/object\n";
+    std::cout << "Equal:       " << equal_ns / kRoundTrips << " ns/object\n";
+    std::cout << "Hash:        " << hash_ns / kRoundTrips << " ns/object\n";
+
+    constexpr size_t kShapes = 100000;
+    constexpr size_t kLoads = 20;
+    Scene scene;
+    for (size_t i = 0; i < kShapes; ++i) {
+        auto circle = std::make_unique<Circle>();
+        circle->id = static_cast<int>(i);
+        scene.shapes.emplace_back(circle.release());
+    }
+    rapidjson::StringBuffer buffer;
+    rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
+    Serialize(scene, writer);
+    rapidjson::Document scene_document;
+    scene_document.Parse(buffer.GetString());
+
+    reflection::KeyOrderCache key_orders;
+    const auto heap_ns = MeasureNanoseconds(kLoads, [&] {
+        Scene loaded;
+        key_orders = {};
+        reflection::DeserializeContext context;
+        context.key_orders = &key_orders;
+        Deserialize(loaded, scene_document, context);
+    });
+    std::pmr::monotonic_buffer_resource arena;
+    const auto arena_ns = MeasureNanoseconds(kLoads, [&] {
+        {
+            Scene loaded;
+            Deserialize(loaded, scene_document, &arena);
+        }
+        arena.release();
+    });
+
+    const auto parallel_ns = MeasureNanoseconds(kLoads, [&] {
+        Scene loaded;
+        Deserialize(loaded, scene_document, reflection::DeserializeParallelOptions{});
+    });
+    const auto try_ns = MeasureNanoseconds(kLoads, [&] {
+        Scene loaded;
+        if (!reflection::TryDeserialize(loaded, scene_document))
+            std::abort();
+    });
+
+    std::cout << "Load " << kShapes << " shapes with new:   " << heap_ns / kLoads / 1e6 << " ms, keys predicted " << key_orders.hits << ", looked up "
+              << key_orders.misses << "\n";
+    std::cout << "Load " << kShapes << " shapes from arena: " << arena_ns / kLoads / 1e6 << " ms\n";
+    std::cout << "Load " << kShapes << " shapes on " << reflection::GetThreadCount(0) << " threads: " << parallel_ns / kLoads / 1e6 << " ms\n";
+    std::cout << "TryDeserialize " << kShapes << " shapes: " << try_ns / kLoads / 1e6 << " ms\n";
+
+    // Reloading the same document into a scene: rebuilt vs in place
+    Scene reloaded;
+    const auto reload_ns = MeasureNanoseconds(kLoads, [&] {
+        Deserialize(reloaded, scene_document);
+    });
+    reflection::DeserializeContext reload_context;
+    const auto in_place_ns = MeasureNanoseconds(kLoads, [&] {
+        reflection::DeserializeInPlace(reloaded, scene_document, reload_context);
+    });
+
+    std::cout << "Reload " << kShapes << " shapes:          " << reload_ns / kLoads / 1e6 << " ms\n";
+    std::cout << "Reload " << kShapes << " shapes in place: " << in_place_ns / kLoads / 1e6 << " ms\n";
+
+    // From text: parse into a Document first vs read tokens straight into the scene
+    const auto dom_ns = MeasureNanoseconds(kLoads, [&] {
+        rapidjson::Document document;
+        document.Parse(buffer.GetString());
+        Scene loaded;
+        Deserialize(loaded, document);
+    });
+    const auto stream_ns = MeasureNanoseconds(kLoads, [&] {
+        rapidjson::StringStream stream(buffer.GetString());
+        Scene loaded;
+        reflection::DeserializeStream(loaded, stream);
+    });
+
+    std::cout << "Parse and load with Document: " << dom_ns / kLoads / 1e6 << " ms\n";
+    std::cout << "Load with DeserializeStream:  " << stream_ns / kLoads / 1e6 << " ms\n";
+
+    // Short strings: one allocation per std::string vs views into the in-situ parsed buffer
+    constexpr size_t kEntries = 100000;
+    std::vector<CatalogEntry<std::string>> catalog(kEntries);
+    for (size_t i = 0; i < kEntries; ++i) {
+        catalog[i].name = "catalog-item-name-" + std::to_string(i);
+        catalog[i].category = "catalog-category-" + std::to_string(i % 64);
+        catalog[i].count = static_cast<int>(i);
+    }
+    rapidjson::StringBuffer catalog_buffer;
+    Serialize(catalog, catalog_buffer, reflection::SerializeMode::Compact);
+    const std::string catalog_json = catalog_buffer.GetString();
+    const auto strings_ns = MeasureNanoseconds(kLoads, [&] {
+        rapidjson::StringStream stream(catalog_json.c_str());
+        std::vector<CatalogEntry<std::string>> loaded;
+        reflection::DeserializeStream(loaded, stream);
+    });
+    const auto views_ns = MeasureNanoseconds(kLoads, [&] {
+        std::string source = catalog_json;
+        std::vector<CatalogEntry<std::string_view>> loaded;
+        reflection::DeserializeInsitu(loaded, source.data());
+    });
+
+    std::cout << "Load " << kEntries << " entries into std::string:      " << strings_ns / kLoads / 1e6 << " ms\n";
+    std::cout << "Load " << kEntries << " entries into std::string_view: " << views_ns / kLoads / 1e6 << " ms\n";
+
+    // Snapshot of the scene: through a document vs reflected deep copy
+    const auto snapshot_json_ns = MeasureNanoseconds(kLoads, [&] {
+        rapidjson::StringBuffer buffer;
+        rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
+        Serialize(scene, writer);
+        rapidjson::Document document;
+        document.Parse(buffer.GetString());
+        Scene snapshot;
+        Deserialize(snapshot, document);
+    });
+    const auto clone_ns = MeasureNanoseconds(kLoads, [&] {
+        Scene snapshot = reflection::Clone<ISerialization>(scene);
+    });
+    Scene snapshot;
+    const auto clone_into_ns = MeasureNanoseconds(kLoads, [&] {
+        reflection::CloneInto<ISerialization>(scene, snapshot);
+    });
+
+    std::cout << "Snapshot through JSON:     " << snapshot_json_ns / kLoads / 1e6 << " ms\n";
+    std::cout << "Snapshot with Clone:       " << clone_ns / kLoads / 1e6 << " ms\n";
+    std::cout << "Snapshot with CloneInto:   " << clone_into_ns / kLoads / 1e6 << " ms\n";
+
+    // Sync one changed radius: full document vs patch
+    static_cast<Circle*>(snapshot.shapes[kShapes / 2].get())->r = 2.0f;
+    std::string patch_json;
+    const auto full_ns = MeasureNanoseconds(kLoads, [&] {
+        rapidjson::StringBuffer buffer;
+        rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
+        Serialize(snapshot, writer);
+        json = buffer.GetString();
+    });
+    const auto diff_ns = MeasureNanoseconds(kLoads, [&] {
+        rapidjson::StringBuffer buffer;
+        rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
+        Diff(scene, snapshot, writer);
+        patch_json = buffer.GetString();
+    });
+    rapidjson::Document patch;
+    patch.Parse(patch_json.c_str());
+    const auto apply_ns = MeasureNanoseconds(1, [&] {
+        Apply(scene, patch);
+    });
+
+    std::cout << "Full document: " << json.size() << " bytes, " << full_ns / kLoads / 1e6 << " ms\n";
+    std::cout << "Diff:          " << patch_json.size() << " bytes, " << diff_ns / kLoads / 1e6 << " ms\n";
+    std::cout << "Apply:         " << apply_ns / 1e3 << " us\n";
+
+    // Compact JSON vs binary encoding of the same fields
+    reflection::BinaryWriter binary_writer;
+    const auto binary_write_ns = MeasureNanoseconds(kRoundTrips, [&] {
+        binary_writer.Clear();
+        reflection::SerializeBinary(test, binary_writer);
+    });
+    const auto binary_read_ns = MeasureNanoseconds(kRoundTrips, [&] {
+        reflection::DeserializeBinary(loaded, binary_writer.GetData(), binary_writer.GetSize());
+    });
+    const auto json_read_ns = MeasureNanoseconds(kRoundTrips, [&] {
+        rapidjson::StringStream stream(compact_json.c_str());
+        reflection::DeserializeStream(loaded, stream);
+    });
+
+    std::cout << "Compact JSON:  " << compact_json.size() << " bytes, write " << compact_ns / kRoundTrips << " ns, read "
+              << json_read_ns / kRoundTrips << " ns\n";
+    std::cout << "Binary:        " << binary_writer.GetSize() << " bytes, write " << binary_write_ns / kRoundTrips << " ns, read "
+              << binary_read_ns / kRoundTrips << " ns\n";
+
+    rapidjson::StringBuffer scene_buffer;
+    const auto scene_json_write_ns = MeasureNanoseconds(kLoads, [&] {
+        scene_buffer.Clear();
+        Serialize(scene, scene_buffer, reflection::SerializeMode::Compact);
+    });
+    const auto scene_json_read_ns = MeasureNanoseconds(kLoads, [&] {
+        rapidjson::StringStream stream(scene_buffer.GetString());
+        Scene loaded;
+        reflection::DeserializeStream(loaded, stream);
+    });
+    const auto scene_binary_write_ns = MeasureNanoseconds(kLoads, [&] {
+        binary_writer.Clear();
+        reflection::SerializeBinary(scene, binary_writer);
+    });
+    const auto scene_binary_read_ns = MeasureNanoseconds(kLoads, [&] {
+        Scene loaded;
+        reflection::DeserializeBinary(loaded, binary_writer.GetData(), binary_writer.GetSize());
+    });
+
+    std::cout << "Scene compact JSON: " << scene_buffer.GetSize() << " bytes, write " << scene_json_write_ns / kLoads / 1e6
+              << " ms, read " << scene_json_read_ns / kLoads / 1e6 << " ms\n";
+    std::cout << "Scene binary:       " << binary_writer.GetSize() << " bytes, write " << scene_binary_write_ns / kLoads / 1e6
+              << " ms, read " << scene_binary_read_ns / kLoads / 1e6 << " ms\n";
+
+    // Archive: opening a mapped file and reading one shape in place vs deserializing the scene
+    constexpr auto kArchivePath = "benchmark_scene.archive";
+    reflection::ArchiveWriter archive_writer;
+    const auto archive_write_ns = MeasureNanoseconds(kLoads, [&] {
+        reflection::SerializeArchive(scene, archive_writer);
+    });
+    archive_writer.Save(kArchivePath);
+    float archive_sum = 0.0f;
+    const auto archive_access_ns = MeasureNanoseconds(kLoads, [&] {
+        reflection::Archive archive;
+        archive.Open(kArchivePath);
+        const auto shapes = reflection::GetArchiveRoot<Scene>(archive).Field<decltype(scene.shapes)>("shapes");
+        archive_sum += shapes[shapes.size() / 2].As<Circle>().Field<float>("r").Get();
+    });
+    std::remove(kArchivePath);
+
+    std::cout << "Scene archive:      " << archive_writer.GetSize() << " bytes, write " << archive_write_ns / kLoads / 1e6
+              << " ms, open and read one shape " << archive_access_ns / kLoads / 1e3 << " us (" << archive_sum << ")\n";
+
+    // Homogeneous array: field by field vs memory images checked by schema hash
+    constexpr size_t kSamples = 1000000;
+    std::vector<Sample> samples(kSamples);
+    for (size_t i = 0; i < kSamples; ++i) {
+        samples[i].position[0] = static_cast<float>(i);
+        samples[i].weight = 0.5f;
+        samples[i].id = static_cast<int>(i);
+    }
+    reflection::BinaryWriter raw_writer(true);
+    const auto fields_write_ns = MeasureNanoseconds(kLoads, [&] {
+        binary_writer.Clear();
+        reflection::SerializeBinary(samples, binary_writer);
+    });
+    const auto raw_write_ns = MeasureNanoseconds(kLoads, [&] {
+        raw_writer.Clear();
+        reflection::SerializeBinary(samples, raw_writer);
+    });
+    std::vector<Sample> loaded_samples;
+    const auto fields_read_ns = MeasureNanoseconds(kLoads, [&] {
+        reflection::DeserializeBinary(loaded_samples, binary_writer.GetData(), binary_writer.GetSize());
+    });
+    const auto raw_read_ns = MeasureNanoseconds(kLoads, [&] {
+        reflection::DeserializeBinary(loaded_samples, raw_writer.GetData(), raw_writer.GetSize());
+    });
+
+    std::cout << kSamples << " samples by field: " << binary_writer.GetSize() << " bytes, write " << fields_write_ns / kLoads / 1e6
+              << " ms, read " << fields_read_ns / kLoads / 1e6 << " ms\n";
+    std::cout << kSamples << " samples raw:      " << raw_writer.GetSize() << " bytes, write " << raw_write_ns / kLoads / 1e6
+              << " ms, read " << raw_read_ns / kLoads / 1e6 << " ms\n";
+
+    // Large float array: floats widened to double vs shortest float text, parsed one token at a time vs in bulk
+    std::vector<float> floats(kSamples);
+    for (size_t i = 0; i < kSamples; ++i)
+        floats[i] = static_cast<float>(i) * 0.01f + 0.3f;
+    rapidjson::StringBuffer floats_buffer;
+    const auto double_write_ns = MeasureNanoseconds(kLoads, [&] {
+        floats_buffer.Clear();
+        rapidjson::Writer<rapidjson::StringBuffer> writer(floats_buffer);
+        writer.StartArray();
+        for (const auto f : floats)
+            writer.Double(static_cast<double>(f));
+        writer.EndArray();
+    });
+    const auto double_size = floats_buffer.GetSize();
+    const auto float_write_ns = MeasureNanoseconds(kLoads, [&] {
+        floats_buffer.Clear();
+        Serialize(floats, floats_buffer, reflection::SerializeMode::Compact);
+    });
+    std::vector<float> loaded_floats;
+    const auto token_read_ns = MeasureNanoseconds(kLoads, [&] {
+        TokenStream stream(floats_buffer.GetString());
+        reflection::DeserializeStream(loaded_floats, stream);
+    });
+    const auto bulk_read_ns = MeasureNanoseconds(kLoads, [&] {
+        rapidjson::StringStream stream(floats_buffer.GetString());
+        reflection::DeserializeStream(loaded_floats, stream);
+    });
+
+    std::cout << kSamples << " floats as double: " << double_size << " bytes, write " << double_write_ns / kLoads / 1e6 << " ms\n";
+    std::cout << kSamples << " floats shortest:  " << floats_buffer.GetSize() << " bytes, write " << float_write_ns / kLoads / 1e6
+              << " ms, read by token " << token_read_ns / kLoads / 1e6 << " ms, in bulk " << bulk_read_ns / kLoads / 1e6 << " ms\n";
+
+    // Scene written by the calling thread vs in chunks on all cores, with the same output
+    rapidjson::StringBuffer parallel_buffer;
+    const auto pretty_write_ns = MeasureNanoseconds(kLoads, [&] {
+        scene_buffer.Clear();
+        Serialize(scene, scene_buffer, reflection::SerializeMode::Pretty);
+    });
+    const auto parallel_write_ns = MeasureNanoseconds(kLoads, [&] {
+        parallel_buffer.Clear();
+        Serialize(scene, parallel_buffer, reflection::SerializeMode::Pretty, reflection::SerializeParallelOptions{});
+    });
+    const bool same_output = std::string_view(scene_buffer.GetString(), scene_buffer.GetSize()) ==
+                             std::string_view(parallel_buffer.GetString(), parallel_buffer.GetSize());
+
+    std::cout << "Scene pretty JSON:  " << scene_buffer.GetSize() << " bytes, write " << pretty_write_ns / kLoads / 1e6 << " ms, on "
+              << reflection::GetThreadCount(0) << " threads " << parallel_write_ns / kLoads / 1e6 << " ms"
+              << (same_output ? "" : " (output differs)") << "\n";
+
+    // Samples as newline-delimited JSON, written and read one record at a time
+    std::stringstream records;
+    const auto records_write_ns = MeasureNanoseconds(1, [&] {
+        rapidjson::OStreamWrapper stream(records);
+        reflection::RecordWriter<Sample, rapidjson::OStreamWrapper> writer(stream);
+        for (const auto& sample : samples)
+            writer.Write(sample);
+    });
+    size_t record_count = 0;
+    const auto records_read_ns = MeasureNanoseconds(1, [&] {
+        rapidjson::IStreamWrapper stream(records);
+        reflection::RecordReader<Sample, rapidjson::IStreamWrapper> reader(stream);
+        for (const auto& sample : reader)
+            record_count += sample.id >= 0;
+    });
+
+    std::cout << record_count << " sample records: " << records.str().size() << " bytes, write " << records_write_ns / 1e6
+              << " ms, read " << records_read_ns / 1e6 << " ms\n";
+}
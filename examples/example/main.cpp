@@ -123,7 +123,7 @@ struct MemoryRecord {
         std::cout << countnew << "\t" << countdelete << "\n";
         bool leak = countnew != countdelete;
         // std::cout << "data:\n";
-        for (int i = 0; i < countnew; ++i) {
+        for (size_t i = 0; i < countnew; ++i) {
             // std::cout << pnewset[i] << "\t" << pdeleteset[i] << "\n";
             leak |= pnewset[i] != pdeleteset[i];
         }
@@ -151,13 +151,16 @@ void operator delete(void* ptr) {
         free(ptr);
     }
 }
+void operator delete(void* ptr, size_t) {
+    operator delete(ptr);
+}
 
 const char* src = R"(
 {
     "b": false,
     "d": 1.23,
     "e": "E1",
-    "f": 2.3399999141693115,
+    "f": 2.34,
     "i": 889,
     "li": [
         0.125,
@@ -175,14 +178,14 @@ const char* src = R"(
     },
     "vec": [
         {
-            "type": "class Circle",
+            "type": 2166834857,
             "data": {
                 "id": 1,
                 "r": 1.0
             }
         },
         {
-            "type": "class Rectangle",
+            "type": 385702446,
             "data": {
                 "id": 2,
                 "w": 2.0,
@@ -225,6 +228,15 @@ int main() {
     document_origin.Parse(src);
     Deserialize(t, document_origin);
     Deserialize(t, document_origin);  // Just for testing memory leak
+    DeserializeInPlace(t, document_origin);  // Reload reusing the memory of t
+
+    // Reading values without memory of their own allocates nothing
+    const auto& pair_value = document_origin["pair"];
+    const auto allocations = countnew;
+    Deserialize(t.pair, pair_value);
+    R_ASSERT(reflection::TryDeserialize(t.pair, pair_value));
+    DeserializeInPlace(t.pair, pair_value);
+    R_ASSERT(countnew == allocations);
 
     rapidjson::StringBuffer sb;
     rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(sb);
@@ -234,6 +246,11 @@ int main() {
     document_new.Parse(sb.GetString());
     R_ASSERT(document_origin == document_new);
 
+    Test loaded;
+    Deserialize(loaded, document_new);
+    R_ASSERT(reflection::Equal<ISerialization>(t, loaded));
+    R_ASSERT(reflection::Hash<ISerialization>(t) == reflection::Hash<ISerialization>(loaded));
+
     auto DrawGui = [&t]() {
         if (ImGui::Button("Serialize")) {
             rapidjson::StringBuffer sb;
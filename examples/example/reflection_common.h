@@ -8,5 +8,6 @@ using reflection::IAutoImGui;
 using reflection::ISerialization;
 
 using reflection::Deserialize;
+using reflection::DeserializeInPlace;
 using reflection::DrawAutoImGui;
 using reflection::Serialize;
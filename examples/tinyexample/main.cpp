@@ -84,13 +84,13 @@ const char* src = R"(
 {
     "data": [
         {
-            "type": "class Circle",
+            "type": 2166834857,
             "data": {
                 "radius": 50.0
             }
         },
         {
-            "type": "class Rectangle",
+            "type": 385702446,
             "data": {
                 "height": 80.0,
                 "width": 120.0
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "reflection.h"
+#include "schema.h"
+#include "util.h"
+
+// Read-only archive that is accessed in place through ArchiveView (see archive_view.h),
+// typically from a file that Archive (see archive_file.h) maps into memory. Integers are
+// in the byte order of the writer, which Archive checks when opening.
+//   header   8-byte magic, u32 byte order mark, u32 0, u64 ArchiveTypeHash of the root, root slot
+//   slot     8 bytes: a number or enum, or the offset of a record relative to the slot, 0 for null
+// Records are 8-byte aligned:
+//   struct   offset of its layout relative to the record, then one slot per field in name order
+//   layout   u32 field count, u32 0, u64 SchemaHash of the struct, then for each field
+//            the offset of its name string relative to the entry and its u64 ArchiveTypeHash
+//   string   u64 size, bytes and a null terminator
+//   array    images of the elements if they are bitwise comparable, one slot each otherwise
+//   vector   u64 count, then elements as in an array (also list and SoaVector)
+//   map      u64 count, then for each element in key order a slot of its key string and a value slot
+//   pointer  slot of the value of a unique_ptr, or for registered subclasses
+//            u32 type id, u32 0 and the slot of the object
+//   image    the bytes of other bitwise comparable values (arrays of numbers, glm types)
+
+namespace reflection {
+
+constexpr char kArchiveMagic[8] = {'R', 'F', 'L', 'A', 'R', 'C', 'H', '1'};
+constexpr uint32_t kArchiveByteOrderMark = 0x01020304;
+constexpr size_t kArchiveHeaderSize = 32;
+constexpr size_t kArchiveRootSlot = 24;
+
+template <class T, class = void>
+struct _ArchiveElementType {
+    using type = void;
+};
+
+template <class T>
+struct _ArchiveElementType<T, std::void_t<typename T::element_type>> {
+    using type = typename T::element_type;
+};
+
+template <class T, class = void>
+struct _ArchiveValueType : _ArchiveElementType<T> {};
+
+template <class T>
+struct _ArchiveValueType<T, std::void_t<typename T::value_type>> {
+    using type = typename T::value_type;
+};
+
+template <class T, class = void>
+struct _ArchiveMappedType : _ArchiveValueType<T> {};
+
+template <class T>
+struct _ArchiveMappedType<T, std::void_t<typename T::mapped_type>> {
+    using type = typename T::mapped_type;
+};
+
+// Fingerprint of the records of T, checked when a field is viewed as a T. Structs are
+// only marked as such, their fields are found by name. Containers and pointers add the
+// fingerprint of their elements.
+template <class I, class T>
+constexpr uint64_t ArchiveTypeHash() {
+    using Element = typename _ArchiveMappedType<T>::type;
+    if constexpr (std::is_array_v<T> || _IsStdArray<T>::value) {
+        using Item = std::remove_cv_t<std::remove_reference_t<decltype(std::declval<T&>()[0])>>;
+        return _SchemaMix(_SchemaMix(0xCBF29CE484222325ull, sizeof(T) / sizeof(Item)), ArchiveTypeHash<I, Item>());
+    } else if constexpr (HasFieldDeclarations<I, T>::value || std::is_base_of_v<I, T>) {
+        return _SchemaMix(0xCBF29CE484222325ull, 'F');
+    } else if constexpr (std::is_void_v<Element>) {
+        return SchemaHash<I, T>();
+    } else {
+        return _SchemaMix(SchemaHash<I, T>(), ArchiveTypeHash<I, std::remove_cv_t<Element>>());
+    }
+}
+
+class ArchiveWriter {
+public:
+    const uint8_t* GetData() const {
+        return buffer.data();
+    }
+
+    size_t GetSize() const {
+        return buffer.size();
+    }
+
+    void Clear() {
+        buffer.clear();
+        layouts.clear();
+    }
+
+    // Appends a zeroed record of size bytes and returns its position
+    size_t Allocate(size_t size) {
+        const auto position = (buffer.size() + 7) & ~size_t(7);
+        buffer.resize(position + size);
+        return position;
+    }
+
+    void Store(size_t position, const void* data, size_t size) {
+        if (size > 0)
+            memcpy(buffer.data() + position, data, size);
+    }
+
+    // Points the slot at position to the record at target
+    void Link(size_t slot, size_t target) {
+        const auto offset = static_cast<int64_t>(target) - static_cast<int64_t>(slot);
+        Store(slot, &offset, 8);
+    }
+
+    size_t WriteString(std::string_view s) {
+        const auto position = Allocate(8 + s.size() + 1);
+        const uint64_t size = s.size();
+        Store(position, &size, 8);
+        Store(position + 8, s.data(), s.size());
+        return position;
+    }
+
+    // Layout of a struct with the fields of a field table, interned by the address of its
+    // first field. type_hashes are the ArchiveTypeHash of the fields.
+    template <class Field>
+    size_t WriteLayout(const Field* first, size_t count, uint64_t hash, const uint64_t* type_hashes) {
+        const auto itr = layouts.find(first);
+        if (itr != layouts.end() && first != nullptr)
+            return itr->second;
+        const auto position = Allocate(16 + 16 * count);
+        const auto count32 = static_cast<uint32_t>(count);
+        Store(position, &count32, 4);
+        Store(position + 8, &hash, 8);
+        for (size_t i = 0; i < count; ++i) {
+            const auto entry = position + 16 + 16 * i;
+            Link(entry, WriteString(first[i].name));
+            Store(entry + 8, &type_hashes[i], 8);
+        }
+        layouts.emplace(first, position);
+        return position;
+    }
+
+    bool Save(const char* path) const {
+        std::ofstream file(path, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+        return static_cast<bool>(file);
+    }
+
+private:
+    std::vector<uint8_t> buffer;
+    std::unordered_map<const void*, size_t> layouts;
+};
+
+}  // namespace reflection
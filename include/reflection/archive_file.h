@@ -0,0 +1,179 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+// The macro of wingdi.h would rename rapidjson's Value::GetObject in code after this header
+#undef GetObject
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "archive.h"
+
+// Archives opened for reading, kept apart from archive.h so that the platform headers
+// are only included where archives are read.
+
+namespace reflection {
+
+// Archive mapped from a file or held in memory. Opening checks the header, views check
+// the records they read, and pages of a mapped file are read when views touch them.
+class Archive {
+public:
+    Archive() = default;
+
+    Archive(const Archive&) = delete;
+    Archive& operator=(const Archive&) = delete;
+
+    Archive(Archive&& other) noexcept {
+        *this = std::move(other);
+    }
+
+    Archive& operator=(Archive&& other) noexcept {
+        if (this != &other) {
+            Close();
+            data = other.data;
+            size = other.size;
+            mapped = other.mapped;
+#ifdef _WIN32
+            mapping = other.mapping;
+            other.mapping = nullptr;
+#endif
+            other.data = nullptr;
+            other.size = 0;
+            other.mapped = false;
+        }
+        return *this;
+    }
+
+    ~Archive() {
+        Close();
+    }
+
+    // Maps the file at path read-only, so that processes opening it share its pages
+    bool Open(const char* path) {
+        Close();
+#ifdef _WIN32
+        const HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+        LARGE_INTEGER file_size;
+        if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+            CloseHandle(file);
+            return false;
+        }
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file);
+        if (mapping == nullptr)
+            return false;
+        const auto view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (view == nullptr) {
+            CloseHandle(mapping);
+            mapping = nullptr;
+            return false;
+        }
+        data = static_cast<const uint8_t*>(view);
+        size = static_cast<size_t>(file_size.QuadPart);
+#else
+        const int file = open(path, O_RDONLY);
+        if (file < 0)
+            return false;
+        struct stat status;
+        if (fstat(file, &status) != 0 || status.st_size == 0) {
+            close(file);
+            return false;
+        }
+        const auto view = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_SHARED, file, 0);
+        close(file);
+        if (view == MAP_FAILED)
+            return false;
+        data = static_cast<const uint8_t*>(view);
+        size = static_cast<size_t>(status.st_size);
+#endif
+        mapped = true;
+        if (!_IsValid()) {
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    // Uses memory that must outlive the archive, such as the data of an ArchiveWriter
+    bool Open(const void* memory, size_t memory_size) {
+        Close();
+        data = static_cast<const uint8_t*>(memory);
+        size = memory_size;
+        if (!_IsValid()) {
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    void Close() {
+        if (mapped) {
+#ifdef _WIN32
+            UnmapViewOfFile(data);
+            CloseHandle(mapping);
+            mapping = nullptr;
+#else
+            munmap(const_cast<uint8_t*>(data), size);
+#endif
+        }
+        data = nullptr;
+        size = 0;
+        mapped = false;
+    }
+
+    bool IsOpen() const {
+        return data != nullptr;
+    }
+
+    const uint8_t* GetData() const {
+        return data;
+    }
+
+    size_t GetSize() const {
+        return size;
+    }
+
+    // ArchiveTypeHash of the root
+    uint64_t GetRootHash() const {
+        uint64_t hash;
+        memcpy(&hash, data + 16, 8);
+        return hash;
+    }
+
+    const uint8_t* GetRootSlot() const {
+        return data + kArchiveRootSlot;
+    }
+
+private:
+    bool _IsValid() const {
+        uint32_t mark;
+        return size >= kArchiveHeaderSize && memcmp(data, kArchiveMagic, 8) == 0 &&
+               (memcpy(&mark, data + 8, 4), mark == kArchiveByteOrderMark);
+    }
+
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    bool mapped = false;
+#ifdef _WIN32
+    HANDLE mapping = nullptr;
+#endif
+};
+
+}  // namespace reflection
@@ -0,0 +1,453 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <list>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "archive_file.h"
+#include "serialization.h"
+
+// Read-only views of the values of an archive written by SerializeArchive, accessed in place:
+//   Archive archive;
+//   archive.Open("scene.bin");
+//   auto scene = GetArchiveRoot<Scene>(archive);
+//   float r = scene.Field<std::vector<Color>>("colors")[i].Field<float>("r").Get();
+// Fields of structs are looked up with the field table of the class when the archive was
+// written with the same declarations, and by the names in the archive otherwise.
+// Records are checked against the bounds of the archive before they are viewed, so that
+// corrupt or truncated archives fail R_ASSERT instead of being read out of bounds.
+
+namespace reflection {
+
+template <class T>
+T _LoadArchiveValue(const uint8_t* p) {
+    T v;
+    memcpy(&v, p, sizeof(T));
+    return v;
+}
+
+// Bytes of an archive, which records must lie in
+struct ArchiveBounds {
+    const uint8_t* begin = nullptr;
+    const uint8_t* end = nullptr;
+};
+
+// True if count elements of stride bytes after header bytes at p, which is in bounds, are too
+inline bool _ArchiveFits(const uint8_t* p, size_t header, uint64_t count, size_t stride, const ArchiveBounds& bounds) {
+    const auto available = static_cast<size_t>(bounds.end - p);
+    return header <= available && count <= (available - header) / stride;
+}
+
+// Record a slot in bounds points to, nullptr for null. The record starts in bounds.
+inline const uint8_t* _ResolveArchiveSlot(const uint8_t* slot, const ArchiveBounds& bounds) {
+    const auto offset = _LoadArchiveValue<int64_t>(slot);
+    if (offset == 0)
+        return nullptr;
+    R_ASSERT(offset >= bounds.begin - slot && offset < bounds.end - slot);
+    return slot + offset;
+}
+
+class ArchiveViewBase {
+public:
+    explicit ArchiveViewBase(const uint8_t* data = nullptr, ArchiveBounds bounds = {}) : data(data), bounds(bounds) {
+    }
+
+    // True for null pointers and strings
+    bool IsNull() const {
+        return data == nullptr;
+    }
+
+    // The record of the value, or its slot if it is a number or enum
+    const uint8_t* GetData() const {
+        return data;
+    }
+
+protected:
+    const uint8_t* data;
+    ArchiveBounds bounds;
+};
+
+// Values of types without a specialization are stored as their JSON text, read by Load
+template <class T, class Enable = void>
+class ArchiveView : public ArchiveViewBase {
+public:
+    using ArchiveViewBase::ArchiveViewBase;
+
+    static void _CheckRecord(const uint8_t* record, const ArchiveBounds& bounds) {
+        R_ASSERT(_ArchiveFits(record, 8, 0, 1, bounds) && _ArchiveFits(record, 8, _LoadArchiveValue<uint64_t>(record), 1, bounds));
+    }
+
+    void Load(T& value, std::pmr::memory_resource* resource = nullptr) const {
+        rapidjson::Document document;
+        document.Parse(reinterpret_cast<const char*>(data + 8), _LoadArchiveValue<uint64_t>(data));
+        R_ASSERT(!document.HasParseError());
+        Deserialize(value, document, resource);
+    }
+
+    T Load() const {
+        T value{};
+        Load(value);
+        return value;
+    }
+};
+
+// Values written as null slots: null strings referenced by pointer and unique_ptr
+template <class T>
+struct _IsArchiveNullable : std::bool_constant<_IsStringReference<T>()> {};
+
+template <class _Ty, class _Dx>
+struct _IsArchiveNullable<std::unique_ptr<_Ty, _Dx>> : std::true_type {};
+
+// View of a record that starts in bounds, checked to lie in them
+template <class T>
+ArchiveView<T> _ArchiveRecordView(const uint8_t* record, const ArchiveBounds& bounds) {
+    if (record != nullptr)
+        ArchiveView<T>::_CheckRecord(record, bounds);
+    else
+        R_ASSERT(_IsArchiveNullable<T>::value);
+    return ArchiveView<T>(record, bounds);
+}
+
+// Value of a slot of a record that was checked
+template <class T>
+ArchiveView<T> _ArchiveSlotView(const uint8_t* slot, const ArchiveBounds& bounds) {
+    if constexpr (std::is_arithmetic_v<T> || std::is_enum_v<T>)
+        return ArchiveView<T>(slot, bounds);
+    else
+        return _ArchiveRecordView<T>(_ResolveArchiveSlot(slot, bounds), bounds);
+}
+
+// Element i of an array record
+template <class T, bool kImages = IsBitwiseComparable<ISerialization, T>()>
+ArchiveView<T> _ArchiveElementView(const uint8_t* elements, size_t i, const ArchiveBounds& bounds) {
+    if constexpr (kImages)
+        return ArchiveView<T>(elements + sizeof(T) * i, bounds);
+    else
+        return _ArchiveSlotView<T>(elements + 8 * i, bounds);
+}
+
+// Numbers, enums and other bitwise comparable values
+template <class T>
+class ArchiveView<T, std::enable_if_t<IsBitwiseComparable<ISerialization, T>() && !std::is_array_v<T> && !_IsStdArray<T>::value>>
+    : public ArchiveViewBase {
+public:
+    using ArchiveViewBase::ArchiveViewBase;
+
+    static void _CheckRecord(const uint8_t* record, const ArchiveBounds& bounds) {
+        R_ASSERT(_ArchiveFits(record, sizeof(T), 0, 1, bounds));
+    }
+
+    T Get() const {
+        return _LoadArchiveValue<T>(data);
+    }
+
+    operator T() const {
+        return Get();
+    }
+};
+
+template <class T>
+class ArchiveView<T, std::enable_if_t<std::is_array_v<T> || _IsStdArray<T>::value>> : public ArchiveViewBase {
+public:
+    using ArchiveViewBase::ArchiveViewBase;
+    using Element = std::remove_cv_t<std::remove_reference_t<decltype(std::declval<T&>()[0])>>;
+
+    static constexpr size_t size() {
+        return sizeof(T) / sizeof(Element);
+    }
+
+    static void _CheckRecord(const uint8_t* record, const ArchiveBounds& bounds) {
+        R_ASSERT(_ArchiveFits(record, 0, size(), IsBitwiseComparable<ISerialization, Element>() ? sizeof(Element) : 8, bounds));
+    }
+
+    ArchiveView<Element> operator[](size_t i) const {
+        return _ArchiveElementView<Element>(data, i, bounds);
+    }
+};
+
+template <class T>
+class ArchiveView<T, std::enable_if_t<std::is_same_v<T, std::string> || _IsStringReference<T>()>> : public ArchiveViewBase {
+public:
+    using ArchiveViewBase::ArchiveViewBase;
+
+    static void _CheckRecord(const uint8_t* record, const ArchiveBounds& bounds) {
+        R_ASSERT(_ArchiveFits(record, 8, 0, 1, bounds));
+        const auto size = _LoadArchiveValue<uint64_t>(record);
+        R_ASSERT(_ArchiveFits(record, 9, size, 1, bounds) && record[8 + size] == 0);
+    }
+
+    std::string_view Get() const {
+        return data != nullptr ? std::string_view(c_str(), static_cast<size_t>(_LoadArchiveValue<uint64_t>(data))) : std::string_view();
+    }
+
+    // Null-terminated
+    const char* c_str() const {
+        return data != nullptr ? reinterpret_cast<const char*>(data + 8) : nullptr;
+    }
+
+    operator std::string_view() const {
+        return Get();
+    }
+};
+
+template <class T, bool kImages = IsBitwiseComparable<ISerialization, T>()>
+class _ArchiveSequenceView : public ArchiveViewBase {
+public:
+    using ArchiveViewBase::ArchiveViewBase;
+
+    static void _CheckRecord(const uint8_t* record, const ArchiveBounds& bounds) {
+        R_ASSERT(_ArchiveFits(record, 8, 0, 1, bounds) && _ArchiveFits(record, 8, _LoadArchiveValue<uint64_t>(record), kImages ? sizeof(T) : 8, bounds));
+    }
+
+    size_t size() const {
+        return static_cast<size_t>(_LoadArchiveValue<uint64_t>(data));
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    ArchiveView<T> operator[](size_t i) const {
+        return _ArchiveElementView<T, kImages>(data + 8, i, bounds);
+    }
+};
+
+template <class _Ty, class _Alloc>
+class ArchiveView<std::vector<_Ty, _Alloc>> : public _ArchiveSequenceView<_Ty> {
+public:
+    using _ArchiveSequenceView<_Ty>::_ArchiveSequenceView;
+};
+
+template <class _Ty, class _Alloc>
+class ArchiveView<std::list<_Ty, _Alloc>> : public _ArchiveSequenceView<_Ty> {
+public:
+    using _ArchiveSequenceView<_Ty>::_ArchiveSequenceView;
+};
+
+template <class I, class T>
+class ArchiveView<SoaVector<I, T>> : public _ArchiveSequenceView<T, false> {
+public:
+    using _ArchiveSequenceView<T, false>::_ArchiveSequenceView;
+};
+
+template <class T>
+class _ArchiveMapView : public ArchiveViewBase {
+public:
+    using ArchiveViewBase::ArchiveViewBase;
+
+    static void _CheckRecord(const uint8_t* record, const ArchiveBounds& bounds) {
+        R_ASSERT(_ArchiveFits(record, 8, 0, 1, bounds) && _ArchiveFits(record, 8, _LoadArchiveValue<uint64_t>(record), 16, bounds));
+    }
+
+    size_t size() const {
+        return static_cast<size_t>(_LoadArchiveValue<uint64_t>(data));
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    // Elements are in key order
+    std::string_view Key(size_t i) const {
+        return _ArchiveSlotView<std::string>(_Entry(i), bounds).Get();
+    }
+
+    ArchiveView<T> Value(size_t i) const {
+        return _ArchiveSlotView<T>(_Entry(i) + 8, bounds);
+    }
+
+    // Binary search of the keys
+    std::optional<ArchiveView<T>> Find(std::string_view key) const {
+        size_t first = 0;
+        size_t last = size();
+        while (first < last) {
+            const auto middle = first + (last - first) / 2;
+            if (Key(middle) < key)
+                first = middle + 1;
+            else
+                last = middle;
+        }
+        if (first == size() || Key(first) != key)
+            return std::nullopt;
+        return Value(first);
+    }
+
+private:
+    const uint8_t* _Entry(size_t i) const {
+        return data + 8 + 16 * i;
+    }
+};
+
+template <template <class _Kty, class _Ty, class _Pr, class _Alloc> class ContainerType,
+          class _Kty, class _Ty, class _Pr, class _Alloc>
+class ArchiveView<ContainerType<_Kty, _Ty, _Pr, _Alloc>, std::enable_if_t<std::is_same_v<std::string, _Kty>>> : public _ArchiveMapView<_Ty> {
+public:
+    using _ArchiveMapView<_Ty>::_ArchiveMapView;
+};
+
+template <template <class _Kty, class _Ty, class _Hasher, class _Keyeq, class _Alloc> class ContainerType,
+          class _Kty, class _Ty, class _Hasher, class _Keyeq, class _Alloc>
+class ArchiveView<ContainerType<_Kty, _Ty, _Hasher, _Keyeq, _Alloc>, std::enable_if_t<std::is_same_v<std::string, _Kty>>> : public _ArchiveMapView<_Ty> {
+public:
+    using _ArchiveMapView<_Ty>::_ArchiveMapView;
+};
+
+// Objects of registered subclasses, viewed as their exact type with As
+template <class _Ty, class _Dx>
+class ArchiveView<std::unique_ptr<_Ty, _Dx>, std::enable_if_t<std::is_base_of_v<ISerialization, _Ty> && SubclassInfo<_Ty>::has>>
+    : public ArchiveViewBase {
+public:
+    using ArchiveViewBase::ArchiveViewBase;
+    using Entry = typename SubclassInfo<_Ty>::FactoryTable::Entry;
+
+    static void _CheckRecord(const uint8_t* record, const ArchiveBounds& bounds) {
+        R_ASSERT(_ArchiveFits(record, 16, 0, 1, bounds));
+    }
+
+    explicit operator bool() const {
+        return data != nullptr;
+    }
+
+    uint32_t GetTypeId() const {
+        return _LoadArchiveValue<uint32_t>(data);
+    }
+
+    // nullptr if the id is not registered
+    const Entry* GetEntry() const {
+        return SubclassInfo<_Ty>::GetFactoryTable().FindById(GetTypeId());
+    }
+
+    template <class U>
+    bool Is() const {
+        const auto entry = data != nullptr ? GetEntry() : nullptr;
+        return entry != nullptr && entry->type() == typeid(U);
+    }
+
+    template <class U>
+    ArchiveView<U> As() const {
+        R_ASSERT(Is<U>());
+        return _ArchiveSlotView<U>(data + 8, bounds);
+    }
+
+    // Fields of subclasses are found by name
+    ArchiveView<_Ty> operator*() const {
+        return _ArchiveSlotView<_Ty>(data + 8, bounds);
+    }
+};
+
+template <class _Ty, class _Dx>
+class ArchiveView<std::unique_ptr<_Ty, _Dx>, std::enable_if_t<!(std::is_base_of_v<ISerialization, _Ty> && SubclassInfo<_Ty>::has)>>
+    : public ArchiveViewBase {
+public:
+    using ArchiveViewBase::ArchiveViewBase;
+
+    static void _CheckRecord(const uint8_t* record, const ArchiveBounds& bounds) {
+        R_ASSERT(_ArchiveFits(record, 8, 0, 1, bounds));
+    }
+
+    explicit operator bool() const {
+        return data != nullptr;
+    }
+
+    ArchiveView<_Ty> operator*() const {
+        return _ArchiveSlotView<_Ty>(data, bounds);
+    }
+};
+
+template <class T>
+class ArchiveView<T, std::enable_if_t<std::is_base_of_v<ISerialization, T> || IsReflectableStruct<ISerialization, T>::value>>
+    : public ArchiveViewBase {
+public:
+    using ArchiveViewBase::ArchiveViewBase;
+
+    // The record has a slot for each field of its layout
+    static void _CheckRecord(const uint8_t* record, const ArchiveBounds& bounds) {
+        R_ASSERT(_ArchiveFits(record, 8, 0, 1, bounds));
+        const auto layout = _ResolveArchiveSlot(record, bounds);
+        R_ASSERT(layout != nullptr && _ArchiveFits(layout, 16, 0, 1, bounds));
+        const auto count = _LoadArchiveValue<uint32_t>(layout);
+        R_ASSERT(_ArchiveFits(layout, 16, count, 16, bounds) && _ArchiveFits(record, 8, count, 8, bounds));
+    }
+
+    size_t GetFieldCount() const {
+        return _LoadArchiveValue<uint32_t>(_Layout());
+    }
+
+    // Fields are in name order
+    std::string_view GetFieldName(size_t i) const {
+        return _ArchiveSlotView<std::string>(_Layout() + 16 + 16 * i, bounds).Get();
+    }
+
+    // std::nullopt if the archive has no field name. It must have been written from an F.
+    template <class F>
+    std::optional<ArchiveView<F>> Find(std::string_view name) const {
+        const auto position = _Find<F>(name);
+        if (position == kNotFound)
+            return std::nullopt;
+        return _ArchiveSlotView<F>(data + 8 + 8 * position, bounds);
+    }
+
+    template <class F>
+    ArchiveView<F> Field(std::string_view name) const {
+        const auto position = _Find<F>(name);
+        R_ASSERT(position != kNotFound);
+        return _ArchiveSlotView<F>(data + 8 + 8 * position, bounds);
+    }
+
+private:
+    static constexpr size_t kNotFound = SIZE_MAX;
+
+    const uint8_t* _Layout() const {
+        return _ResolveArchiveSlot(data, bounds);
+    }
+
+    template <class F>
+    size_t _Find(std::string_view name) const {
+        const auto layout = _Layout();
+        if constexpr (HasFieldDeclarations<ISerialization, T>::value) {
+            if (_LoadArchiveValue<uint64_t>(layout + 8) == SchemaHash<ISerialization, T>()) {
+                using Table = FieldTableOf<ISerialization, T>;
+                const typename IReflectionBase<ISerialization>::FieldTable table(Table::fields, Table::index.GetView());
+                const auto field = table.Find(name);
+                if (field == nullptr)
+                    return kNotFound;
+                R_ASSERT((field->type == Type<ISerialization, F>::GetIType()));
+                R_ASSERT(static_cast<size_t>(field - table.begin()) < GetFieldCount());
+                return field - table.begin();
+            }
+        }
+        size_t first = 0;
+        size_t last = GetFieldCount();
+        while (first < last) {
+            const auto middle = first + (last - first) / 2;
+            if (GetFieldName(middle) < name)
+                first = middle + 1;
+            else
+                last = middle;
+        }
+        if (first == GetFieldCount() || GetFieldName(first) != name)
+            return kNotFound;
+        R_ASSERT((_LoadArchiveValue<uint64_t>(layout + 24 + 16 * first) == ArchiveTypeHash<ISerialization, F>()));
+        return first;
+    }
+};
+
+// View of the root of an archive written from a T. Other roots than structs must have
+// the same ArchiveTypeHash.
+template <class T>
+ArchiveView<T> GetArchiveRoot(const Archive& archive) {
+    if constexpr (!(std::is_base_of_v<ISerialization, T> || IsReflectableStruct<ISerialization, T>::value))
+        R_ASSERT((archive.GetRootHash() == ArchiveTypeHash<ISerialization, T>()));
+    return _ArchiveSlotView<T>(archive.GetRootSlot(), ArchiveBounds{archive.GetData(), archive.GetData() + archive.GetSize()});
+}
+
+}  // namespace reflection
@@ -11,6 +11,7 @@
 #include <vector>
 
 #include "reflection.h"
+#include "soa.h"
 #include "util.h"
 
 namespace reflection {
@@ -26,7 +27,7 @@ public:
 
 template <class T>
 void DrawAutoImGui(T& object, const char* name = nullptr) {
-    const Type<IAutoImGui, T>::Userdata userdata = {};
+    const typename Type<IAutoImGui, T>::Userdata userdata = {};
     Type<IAutoImGui, T>::GetIType()->DrawAutoImGui(&object, name, &userdata);
 }
 
@@ -48,7 +49,7 @@ public:
 template <>
 class Type<IAutoImGui, bool> : public TypeBase<IAutoImGui, bool> {
 public:
-    void DrawAutoImGui(void* addr, const char* name, const UserdataBase* userdata) const override {
+    void DrawAutoImGui(void* addr, const char* name, const UserdataBase*) const override {
         auto p = static_cast<ValueType*>(addr);
         ImGui::Checkbox(name, p);
     }
@@ -80,7 +81,7 @@ public:
             *i++ = *j++;
     }
 
-    void DrawAutoImGui(void* addr, const char* name, const UserdataBase* userdata) const override {
+    void DrawAutoImGui(void* addr, const char* name, const UserdataBase*) const override {
         auto p = static_cast<T*>(addr);
         char buf[MaxEnumStringViewSize<T>() + 1];
         auto curstrview = magic_enum::enum_name(*p);
@@ -107,12 +108,12 @@ class Type<IAutoImGui, T, std::enable_if_t<std::is_base_of_v<IAutoImGui, T> || I
 public:
     using ValueType = T;
 
-    void DrawAutoImGui(void* addr, const char* name, const UserdataBase* userdata) const override {
+    void DrawAutoImGui(void* addr, const char* name, const UserdataBase*) const override {
         auto& v = *static_cast<ValueType*>(addr);
         if (ScopeImGuiTreeNode tree(name); tree) {
-            for (const auto& [name, fun] : GetFieldTable(v, static_cast<IAutoImGui*>(nullptr))) {
-                auto info = fun(&v);
-                info.type->DrawAutoImGui(info.address, name.c_str(), info.userdata);
+            const auto table = GetFieldTable(v, static_cast<IAutoImGui*>(nullptr));
+            for (const auto& field : table) {
+                field.type->DrawAutoImGui(table.GetAddress(field), field.name.data(), field.userdata);
             }
         }
     }
@@ -142,15 +143,15 @@ public:
             ImGui::Text("%s is null", name);
             if (ScopeImGuiPopupContextItem popup(name); popup) {
                 if constexpr (std::is_base_of_v<IAutoImGui, _Ty> && SubclassInfo<_Ty>::has) {
-                    for (const auto& [name, factory] : SubclassInfo<_Ty>::GetFactoryTable()) {
-                        if (ImGui::MenuItem(name.c_str())) {
-                            v.reset(factory());
+                    for (const auto& entry : SubclassInfo<_Ty>::GetFactoryTable()) {
+                        if (ImGui::MenuItem(entry.name.data())) {
+                            ResetUniquePtr(v, entry.factory(nullptr), nullptr, entry.size, entry.alignment);
                             break;
                         }
                     }
                 } else {
                     if (ImGui::MenuItem("new")) {
-                        v.reset(new _Ty());
+                        ResetUniquePtr(v, CreateObject<_Ty>(nullptr), nullptr, sizeof(_Ty), alignof(_Ty));
                     }
                 }
             }
@@ -304,4 +305,47 @@ public:
     }
 };
 
+// Drawn the same as std::vector<T>, each row through a copy written back
+template <class I, class T>
+class Type<IAutoImGui, SoaVector<I, T>> : public TypeBase<IAutoImGui, SoaVector<I, T>> {
+public:
+    using ValueType = SoaVector<I, T>;
+
+    struct Userdata : Type<IAutoImGui, T>::Userdata {};
+
+    void DrawAutoImGui(void* addr, const char* name, const UserdataBase* userdata) const override {
+        auto& v = *static_cast<ValueType*>(addr);
+
+        ScopeImGuiTreeNode tree(name);
+        if (ScopeImGuiPopupContextItem popup; popup) {
+            if (ImGui::MenuItem("clear")) {
+                v.clear();
+            } else if (ImGui::MenuItem("append")) {
+                v.emplace_back();
+            } else if (ImGui::MenuItem("pop")) {
+                if (!v.empty()) {
+                    v.pop_back();
+                }
+            }
+        }
+        if (tree) {
+            constexpr size_t kBufSize = 128;
+            char buf[kBufSize];
+            for (size_t i = 0; i < v.size(); ++i) {
+                if (i > 0) {
+                    snprintf(buf, kBufSize, "exchange(%zu, %zu)", i - 1, i);
+                    if (ImGui::Button(buf)) {
+                        v.Swap(i - 1, i);
+                        break;
+                    }
+                }
+                snprintf(buf, kBufSize, "%zu", i);
+                auto row = v.Load(i);
+                Type<IAutoImGui, T>::GetIType()->DrawAutoImGui(&row, buf, userdata);
+                v.Store(i, std::move(row));
+            }
+        }
+    }
+};
+
 }  // namespace reflection
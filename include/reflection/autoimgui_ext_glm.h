@@ -3,6 +3,7 @@
 #include <glm/glm.hpp>
 
 #include "autoimgui.h"
+#include "compare_ext_glm.h"
 
 namespace reflection {
 
@@ -0,0 +1,837 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "util.h"
+
+// Compact self-describing binary encoding. A value is a tag byte followed by:
+//   Null, False, True       nothing
+//   UInt                    varint
+//   Int                     zigzag varint
+//   Float32, Float64        little-endian IEEE 754
+//   String                  string
+//   Array                   varint count and count values
+//   Float32Array            varint count and count little-endian floats
+//   Float64Array            varint count and count little-endian doubles
+//   Object                  shape and one value for each name of the shape
+//   Map                     varint count and count pairs of string and value
+//   Typed                   type id and value, for objects of a registered subclass
+//   Raw                     raw layout, varint count and count images of the layout size
+// A string is a varint size, its bytes and a null terminator, so that strings can be
+// referenced in the buffer. Shapes (lists of field names), type ids and raw layouts are
+// interned: a varint 0 is followed by a new one, any other varint n refers to the
+// (n - 1)th one of the stream. A new shape is a varint name count and strings, a new
+// type id a varint. A new raw layout is its 8-byte little-endian schema hash, varint
+// size and varint leaf count, then for each leaf its path string, varint offset,
+// kind byte, varint count and varint stride.
+// Raw images are in the byte order of the writer, and meant for readers of the same build.
+// Their bytes outside the leaves, padding and undeclared members, are zeros.
+
+namespace reflection {
+
+enum class BinaryTag : uint8_t {
+    Null,
+    False,
+    True,
+    UInt,
+    Int,
+    Float32,
+    Float64,
+    String,
+    Array,
+    Float32Array,
+    Float64Array,
+    Object,
+    Map,
+    Typed,
+    Raw,
+};
+
+// Type of the scalars of a raw leaf. Bytes are opaque trivially copyable values.
+enum class BinaryRawKind : uint8_t {
+    Bool,
+    Int8,
+    UInt8,
+    Int16,
+    UInt16,
+    Int32,
+    UInt32,
+    Int64,
+    UInt64,
+    Float32,
+    Float64,
+    Bytes,
+};
+
+// count scalars at offset, stride bytes apart. Bytes leaves are count bytes.
+struct BinaryRawLeaf {
+    std::string_view path;
+    size_t offset;
+    BinaryRawKind kind;
+    size_t count;
+    size_t stride;
+    // Checks that a scalar read is a value of the leaf type, null if any bytes are.
+    // Not written.
+    bool (*valid)(const uint8_t* p) = nullptr;
+};
+
+// Memory image of a trivially copyable object: its schema hash, size and scalar leaves
+struct BinaryRawLayout {
+    uint64_t hash = 0;
+    size_t size = 0;
+    std::vector<BinaryRawLeaf> leaves;
+    // Offsets and sizes of the contiguous bytes of the leaves, empty if they cover the
+    // whole image. Not written.
+    std::vector<std::pair<size_t, size_t>> spans;
+    // Storage of leaf paths built at run time
+    std::deque<std::string> paths;
+};
+
+inline bool _BinaryIsLittleEndian() {
+    const uint16_t one = 1;
+    uint8_t first;
+    memcpy(&first, &one, 1);
+    return first == 1;
+}
+
+// Copies n elements of size bytes, reversing their bytes on big-endian machines
+inline void _BinaryCopyLittleEndian(void* dst, const void* src, size_t size, size_t n) {
+    if (n == 0)
+        return;
+    if (_BinaryIsLittleEndian()) {
+        memcpy(dst, src, size * n);
+        return;
+    }
+    auto d = static_cast<uint8_t*>(dst);
+    auto s = static_cast<const uint8_t*>(src);
+    for (size_t i = 0; i < n; ++i, d += size, s += size)
+        for (size_t j = 0; j < size; ++j)
+            d[j] = s[size - 1 - j];
+}
+
+inline size_t _BinaryRawKindSize(BinaryRawKind kind) {
+    constexpr size_t sizes[] = {sizeof(bool), 1, 1, 2, 2, 4, 4, 8, 8, 4, 8, 1};
+    return sizes[static_cast<size_t>(kind)];
+}
+
+// Sets the spans of layout from its leaves
+inline void _SetBinaryRawSpans(BinaryRawLayout& layout) {
+    std::vector<std::pair<size_t, size_t>> extents;
+    for (const auto& leaf : layout.leaves) {
+        if (leaf.count == 0)
+            continue;
+        const auto size = leaf.kind == BinaryRawKind::Bytes ? leaf.count : (leaf.count - 1) * leaf.stride + _BinaryRawKindSize(leaf.kind);
+        extents.emplace_back(leaf.offset, leaf.offset + size);
+    }
+    std::sort(extents.begin(), extents.end());
+    layout.spans.clear();
+    for (const auto& [first, last] : extents) {
+        if (!layout.spans.empty() && layout.spans.back().first + layout.spans.back().second >= first)
+            layout.spans.back().second = std::max(layout.spans.back().second, last - layout.spans.back().first);
+        else
+            layout.spans.emplace_back(first, last - first);
+    }
+    if (layout.spans.size() == 1 && layout.spans[0].first == 0 && layout.spans[0].second == layout.size)
+        layout.spans.clear();
+}
+
+template <class T>
+T _LoadBinaryRaw(const uint8_t* p) {
+    T v;
+    memcpy(&v, p, sizeof(T));
+    return v;
+}
+
+template <class F>
+void _VisitBinaryRawScalar(BinaryRawKind kind, const uint8_t* p, F&& f) {
+    switch (kind) {
+    case BinaryRawKind::Bool: return f(_LoadBinaryRaw<uint8_t>(p) != 0);
+    case BinaryRawKind::Int8: return f(_LoadBinaryRaw<int8_t>(p));
+    case BinaryRawKind::UInt8: return f(_LoadBinaryRaw<uint8_t>(p));
+    case BinaryRawKind::Int16: return f(_LoadBinaryRaw<int16_t>(p));
+    case BinaryRawKind::UInt16: return f(_LoadBinaryRaw<uint16_t>(p));
+    case BinaryRawKind::Int32: return f(_LoadBinaryRaw<int32_t>(p));
+    case BinaryRawKind::UInt32: return f(_LoadBinaryRaw<uint32_t>(p));
+    case BinaryRawKind::Int64: return f(_LoadBinaryRaw<int64_t>(p));
+    case BinaryRawKind::UInt64: return f(_LoadBinaryRaw<uint64_t>(p));
+    case BinaryRawKind::Float32: return f(_LoadBinaryRaw<float>(p));
+    case BinaryRawKind::Float64: return f(_LoadBinaryRaw<double>(p));
+    case BinaryRawKind::Bytes: break;
+    }
+    R_ASSERT(false);
+}
+
+template <class T, class N>
+void _StoreBinaryRaw(uint8_t* p, N v) {
+    const auto t = static_cast<T>(v);
+    memcpy(p, &t, sizeof(T));
+}
+
+// Converts a scalar between kinds other than Bytes, as static_cast does
+inline void _ConvertBinaryRawScalar(BinaryRawKind from, const uint8_t* src, BinaryRawKind to, uint8_t* dst) {
+    _VisitBinaryRawScalar(from, src, [to, dst](auto v) {
+        switch (to) {
+        case BinaryRawKind::Bool: return _StoreBinaryRaw<bool>(dst, v);
+        case BinaryRawKind::Int8: return _StoreBinaryRaw<int8_t>(dst, v);
+        case BinaryRawKind::UInt8: return _StoreBinaryRaw<uint8_t>(dst, v);
+        case BinaryRawKind::Int16: return _StoreBinaryRaw<int16_t>(dst, v);
+        case BinaryRawKind::UInt16: return _StoreBinaryRaw<uint16_t>(dst, v);
+        case BinaryRawKind::Int32: return _StoreBinaryRaw<int32_t>(dst, v);
+        case BinaryRawKind::UInt32: return _StoreBinaryRaw<uint32_t>(dst, v);
+        case BinaryRawKind::Int64: return _StoreBinaryRaw<int64_t>(dst, v);
+        case BinaryRawKind::UInt64: return _StoreBinaryRaw<uint64_t>(dst, v);
+        case BinaryRawKind::Float32: return _StoreBinaryRaw<float>(dst, v);
+        case BinaryRawKind::Float64: return _StoreBinaryRaw<double>(dst, v);
+        case BinaryRawKind::Bytes: break;
+        }
+        R_ASSERT(false);
+    });
+}
+
+class BinaryWriter {
+public:
+    // In raw mode, objects of raw layouts are written as memory images
+    explicit BinaryWriter(bool raw = false) : raw(raw) {
+    }
+
+    bool IsRaw() const {
+        return raw;
+    }
+
+    const uint8_t* GetData() const {
+        return buffer.data();
+    }
+
+    size_t GetSize() const {
+        return size;
+    }
+
+    // Starts a new stream, forgetting interned shapes and type ids
+    void Clear() {
+        size = 0;
+        shapes.clear();
+        recent_shapes = {};
+        type_ids.clear();
+        raw_layouts.clear();
+    }
+
+    void WriteTag(BinaryTag tag) {
+        *_Grow(1) = static_cast<uint8_t>(tag);
+    }
+
+    void WriteVarint(uint64_t v) {
+        auto p = _Grow(10);
+        size_t n = 0;
+        while (v >= 0x80) {
+            p[n++] = static_cast<uint8_t>(v | 0x80);
+            v >>= 7;
+        }
+        p[n++] = static_cast<uint8_t>(v);
+        size -= 10 - n;
+    }
+
+    void WriteNull() {
+        WriteTag(BinaryTag::Null);
+    }
+
+    void WriteBool(bool b) {
+        WriteTag(b ? BinaryTag::True : BinaryTag::False);
+    }
+
+    void WriteUInt(uint64_t u) {
+        WriteTag(BinaryTag::UInt);
+        WriteVarint(u);
+    }
+
+    void WriteInt(int64_t i) {
+        WriteTag(BinaryTag::Int);
+        WriteVarint((static_cast<uint64_t>(i) << 1) ^ static_cast<uint64_t>(i >> 63));
+    }
+
+    void WriteFloat(float f) {
+        WriteTag(BinaryTag::Float32);
+        _BinaryCopyLittleEndian(_Grow(4), &f, 4, 1);
+    }
+
+    void WriteDouble(double d) {
+        WriteTag(BinaryTag::Float64);
+        _BinaryCopyLittleEndian(_Grow(8), &d, 8, 1);
+    }
+
+    void WriteString(std::string_view s) {
+        WriteTag(BinaryTag::String);
+        _WriteString(s);
+    }
+
+    void WriteFloatArray(const float* v, size_t n) {
+        WriteTag(BinaryTag::Float32Array);
+        WriteVarint(n);
+        _BinaryCopyLittleEndian(_Grow(n * 4), v, 4, n);
+    }
+
+    void WriteDoubleArray(const double* v, size_t n) {
+        WriteTag(BinaryTag::Float64Array);
+        WriteVarint(n);
+        _BinaryCopyLittleEndian(_Grow(n * 8), v, 8, n);
+    }
+
+    void StartArray(size_t count) {
+        WriteTag(BinaryTag::Array);
+        WriteVarint(count);
+    }
+
+    void StartMap(size_t count) {
+        WriteTag(BinaryTag::Map);
+        WriteVarint(count);
+    }
+
+    void WriteMapKey(std::string_view key) {
+        _WriteString(key);
+    }
+
+    // Starts an object with the names of the fields in [first, last), an array of elements
+    // with a name, which is interned by the address of its first element
+    template <class Field>
+    void StartObject(const Field* first, const Field* last) {
+        WriteTag(BinaryTag::Object);
+        auto& recent = recent_shapes[(reinterpret_cast<uintptr_t>(first) >> 4) % kRecentShapes];
+        if (recent.first == first && first != nullptr) {
+            WriteVarint(recent.second);
+            return;
+        }
+        const auto [itr, inserted] = shapes.try_emplace(first, static_cast<uint32_t>(shapes.size() + 1));
+        recent = *itr;
+        if (!inserted) {
+            WriteVarint(itr->second);
+            return;
+        }
+        WriteVarint(0);
+        WriteVarint(static_cast<size_t>(last - first));
+        for (auto field = first; field != last; ++field)
+            _WriteString(field->name);
+    }
+
+    // Followed by the value of the object
+    void StartTyped(uint32_t type_id) {
+        WriteTag(BinaryTag::Typed);
+        const auto [itr, inserted] = type_ids.try_emplace(type_id, static_cast<uint32_t>(type_ids.size() + 1));
+        if (!inserted) {
+            WriteVarint(itr->second);
+            return;
+        }
+        WriteVarint(0);
+        WriteVarint(type_id);
+    }
+
+    // Writes count objects of layout at data, with one copy if its leaves cover the images
+    void WriteRaw(const BinaryRawLayout& layout, const void* data, size_t count) {
+        WriteTag(BinaryTag::Raw);
+        const auto [itr, inserted] = raw_layouts.try_emplace(&layout, static_cast<uint32_t>(raw_layouts.size() + 1));
+        if (inserted) {
+            WriteVarint(0);
+            _BinaryCopyLittleEndian(_Grow(8), &layout.hash, 8, 1);
+            WriteVarint(layout.size);
+            WriteVarint(layout.leaves.size());
+            for (const auto& leaf : layout.leaves) {
+                _WriteString(leaf.path);
+                WriteVarint(leaf.offset);
+                *_Grow(1) = static_cast<uint8_t>(leaf.kind);
+                WriteVarint(leaf.count);
+                WriteVarint(leaf.stride);
+            }
+        } else {
+            WriteVarint(itr->second);
+        }
+        WriteVarint(count);
+        if (count == 0)
+            return;
+        const auto images = _Grow(layout.size * count);
+        if (layout.spans.empty()) {
+            memcpy(images, data, layout.size * count);
+            return;
+        }
+        memset(images, 0, layout.size * count);
+        for (size_t i = 0; i < count; ++i) {
+            const auto offset = i * layout.size;
+            for (const auto& [first, size] : layout.spans)
+                memcpy(images + offset + first, static_cast<const uint8_t*>(data) + offset + first, size);
+        }
+    }
+
+private:
+    uint8_t* _Grow(size_t n) {
+        if (size + n > buffer.size())
+            buffer.resize((size + n) * 2);
+        const auto p = buffer.data() + size;
+        size += n;
+        return p;
+    }
+
+    void _WriteString(std::string_view s) {
+        WriteVarint(s.size());
+        auto p = _Grow(s.size() + 1);
+        memcpy(p, s.data(), s.size());
+        p[s.size()] = 0;
+    }
+
+    std::vector<uint8_t> buffer;
+    size_t size = 0;
+    // Shapes looked up last, by address
+    static constexpr size_t kRecentShapes = 64;
+    std::array<std::pair<const void*, uint32_t>, kRecentShapes> recent_shapes{};
+    std::unordered_map<const void*, uint32_t> shapes;
+    std::unordered_map<uint32_t, uint32_t> type_ids;
+    std::unordered_map<const BinaryRawLayout*, uint32_t> raw_layouts;
+    bool raw;
+};
+
+// Reads a buffer written by BinaryWriter, which must outlive strings read from it.
+// Malformed input fails R_ASSERT.
+class BinaryReader {
+public:
+    static constexpr uint32_t kNoField = UINT32_MAX;
+    static constexpr uint32_t kDuplicateField = UINT32_MAX - 1;
+
+    // Fields of a table the names of a shape are in
+    struct ShapeMatch {
+        const void* table;
+        std::vector<uint32_t> positions;
+        // True if positions are all fields of the table, each once
+        bool complete;
+    };
+
+    // Names of an interned shape, and their matches to the tables they were read into
+    struct Shape {
+        std::vector<std::string_view> names;
+        std::deque<ShapeMatch> matches;
+    };
+
+    // Leaves of a raw layout written that are in a layout read into, by path
+    struct RawMatch {
+        const BinaryRawLayout* to;
+        // Same schema hash and size: the spans of images are copied as they are
+        bool identical;
+        // Indices of the leaves of to whose scalars are checked
+        std::vector<uint32_t> checked;
+        // Pairs of leaf indices in the layout written and in to
+        std::vector<std::pair<uint32_t, uint32_t>> leaves;
+        // Paths of leaves of to that were not written, and of leaves written that to lacks
+        std::vector<std::string_view> missing;
+        std::vector<std::string_view> unknown;
+    };
+
+    // Interned raw layout, and its matches to the layouts it was read into
+    struct RawLayout {
+        BinaryRawLayout layout;
+        std::deque<RawMatch> matches;
+    };
+
+    // Images of a Raw value and how they map to the layout read into
+    struct RawImages {
+        const BinaryRawLayout* from;
+        const RawMatch* match;
+        size_t count;
+        const uint8_t* data;
+    };
+
+    BinaryReader(const void* data, size_t size)
+        : p(static_cast<const uint8_t*>(data)), end(static_cast<const uint8_t*>(data) + size) {
+    }
+
+    bool AtEnd() const {
+        return p == end;
+    }
+
+    BinaryTag PeekTag() const {
+        R_ASSERT(p != end);
+        return static_cast<BinaryTag>(*p);
+    }
+
+    BinaryTag ReadTag() {
+        const auto tag = PeekTag();
+        ++p;
+        return tag;
+    }
+
+    void ExpectTag(BinaryTag tag) {
+        const bool expected = ReadTag() == tag;
+        R_ASSERT(expected);
+    }
+
+    uint64_t ReadVarint() {
+        uint64_t v = 0;
+        for (unsigned shift = 0;; shift += 7) {
+            R_ASSERT(p != end && shift < 64);
+            const auto byte = *p++;
+            v |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0)
+                return v;
+        }
+    }
+
+    // The value after a tag
+
+    int64_t ReadIntValue(BinaryTag tag) {
+        const auto v = ReadVarint();
+        if (tag == BinaryTag::UInt) {
+            R_ASSERT(v <= static_cast<uint64_t>(INT64_MAX));
+            return static_cast<int64_t>(v);
+        }
+        R_ASSERT(tag == BinaryTag::Int);
+        return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+    }
+
+    // Accepts integers too, as JSON numbers
+    double ReadNumberValue(BinaryTag tag) {
+        if (tag == BinaryTag::Float32) {
+            float f;
+            _BinaryCopyLittleEndian(&f, _Take(4), 4, 1);
+            return f;
+        }
+        if (tag == BinaryTag::Float64) {
+            double d;
+            _BinaryCopyLittleEndian(&d, _Take(8), 8, 1);
+            return d;
+        }
+        if (tag == BinaryTag::UInt)
+            return static_cast<double>(ReadVarint());
+        return static_cast<double>(ReadIntValue(tag));
+    }
+
+    // Null-terminated in the buffer
+    std::string_view ReadStringValue() {
+        const auto size = ReadVarint();
+        R_ASSERT(size < static_cast<uint64_t>(end - p));
+        const auto s = reinterpret_cast<const char*>(_Take(size + 1));
+        R_ASSERT(s[size] == 0);
+        return std::string_view(s, size);
+    }
+
+    std::string_view ReadString() {
+        ExpectTag(BinaryTag::String);
+        return ReadStringValue();
+    }
+
+    // Reads n numbers written by WriteFloatArray, WriteDoubleArray or as an Array
+    template <class T>
+    void ReadNumbers(T* v, size_t n) {
+        const auto tag = ReadTag();
+        R_ASSERT(ReadCount() == n);
+        ReadNumbersValue(tag, v, n);
+    }
+
+    // The elements after the tag and count of an Array, Float32Array or Float64Array of numbers
+    template <class T>
+    void ReadNumbersValue(BinaryTag tag, T* v, size_t n) {
+        if (tag == BinaryTag::Array) {
+            for (size_t i = 0; i < n; ++i)
+                v[i] = static_cast<T>(ReadNumberValue(ReadTag()));
+            return;
+        }
+        if (tag == BinaryTag::Float32Array && sizeof(T) != 4) {
+            for (size_t i = 0; i < n; ++i) {
+                float f;
+                _BinaryCopyLittleEndian(&f, _Take(4), 4, 1);
+                v[i] = static_cast<T>(f);
+            }
+            return;
+        }
+        if (tag == BinaryTag::Float64Array && sizeof(T) != 8) {
+            for (size_t i = 0; i < n; ++i) {
+                double d;
+                _BinaryCopyLittleEndian(&d, _Take(8), 8, 1);
+                v[i] = static_cast<T>(d);
+            }
+            return;
+        }
+        R_ASSERT(tag == BinaryTag::Float32Array || tag == BinaryTag::Float64Array);
+        _BinaryCopyLittleEndian(v, _Take(static_cast<uint64_t>(n) * sizeof(T)), sizeof(T), n);
+    }
+
+    // Count of an Array, Float32Array or Float64Array after its tag
+    size_t ReadCount() {
+        const auto count = ReadVarint();
+        R_ASSERT(count <= static_cast<uint64_t>(end - p));
+        return static_cast<size_t>(count);
+    }
+
+    // Shape of an Object after its tag
+    Shape& ReadShape() {
+        const auto ref = ReadVarint();
+        if (ref != 0) {
+            R_ASSERT(ref <= shapes.size());
+            return shapes[ref - 1];
+        }
+        Shape& shape = shapes.emplace_back();
+        const auto count = ReadCount();
+        shape.names.reserve(count);
+        for (size_t i = 0; i < count; ++i)
+            shape.names.push_back(ReadStringValue());
+        return shape;
+    }
+
+    // Type id of a Typed value after its tag
+    uint32_t ReadTypeId() {
+        const auto ref = ReadVarint();
+        if (ref != 0) {
+            R_ASSERT(ref <= type_ids.size());
+            return type_ids[ref - 1];
+        }
+        const auto id = ReadVarint();
+        R_ASSERT(id <= UINT32_MAX);
+        type_ids.push_back(static_cast<uint32_t>(id));
+        return type_ids.back();
+    }
+
+    // Matches the names of shape to the fields of table, a field table, once for each table.
+    // Names of no field are kNoField, names already matched are kDuplicateField.
+    template <class Table>
+    const ShapeMatch& MatchShape(Shape& shape, const Table& table) {
+        for (const auto& match : shape.matches) {
+            if (match.table == table.begin())
+                return match;
+        }
+        ShapeMatch& match = shape.matches.emplace_back(ShapeMatch{table.begin(), std::vector<uint32_t>(shape.names.size(), kNoField), false});
+        std::vector<bool> found(table.size());
+        size_t found_count = 0;
+        for (size_t i = 0; i < shape.names.size(); ++i) {
+            const auto field = table.Find(shape.names[i]);
+            if (field == nullptr)
+                continue;
+            const auto position = static_cast<size_t>(field - table.begin());
+            if (found[position]) {
+                match.positions[i] = kDuplicateField;
+                continue;
+            }
+            found[position] = true;
+            ++found_count;
+            match.positions[i] = static_cast<uint32_t>(position);
+        }
+        match.complete = found_count == table.size() && found_count == shape.names.size();
+        return match;
+    }
+
+    // Raw value after its tag, to be read into objects of layout to
+    RawImages ReadRaw(const BinaryRawLayout& to) {
+        auto& raw_layout = _ReadRawLayout();
+        const auto count = ReadCount();
+        R_ASSERT(count <= static_cast<uint64_t>(end - p) / raw_layout.layout.size);
+        const auto data = _Take(static_cast<uint64_t>(count) * raw_layout.layout.size);
+        return RawImages{&raw_layout.layout, &_MatchRaw(raw_layout, to), count, data};
+    }
+
+    // Copies images into images.count objects of the layout they were matched to at dst.
+    // Scalars of leaves of another kind are converted, leaves not written and bytes outside
+    // the leaves are left as they are. Returns false at the first scalar that is not a value
+    // of its leaf, such as a bool that is neither 0 nor 1, which is not copied.
+    static bool CopyRaw(const RawImages& images, void* dst) {
+        const auto& match = *images.match;
+        const auto& to_layout = *match.to;
+        if (match.identical) {
+            for (size_t i = 0; i < images.count; ++i) {
+                const auto src_image = images.data + i * to_layout.size;
+                for (const auto index : match.checked) {
+                    const auto& leaf = to_layout.leaves[index];
+                    for (size_t k = 0; k < leaf.count; ++k) {
+                        if (!leaf.valid(src_image + leaf.offset + k * leaf.stride))
+                            return false;
+                    }
+                }
+            }
+            if (images.count == 0)
+                return true;
+            if (to_layout.spans.empty()) {
+                memcpy(dst, images.data, images.count * to_layout.size);
+                return true;
+            }
+            for (size_t i = 0; i < images.count; ++i) {
+                const auto offset = i * to_layout.size;
+                for (const auto& [first, size] : to_layout.spans)
+                    memcpy(static_cast<uint8_t*>(dst) + offset + first, images.data + offset + first, size);
+            }
+            return true;
+        }
+        for (size_t i = 0; i < images.count; ++i) {
+            const auto src_image = images.data + i * images.from->size;
+            const auto dst_image = static_cast<uint8_t*>(dst) + i * to_layout.size;
+            for (const auto& [from_index, to_index] : match.leaves) {
+                const auto& from = images.from->leaves[from_index];
+                const auto& to = to_layout.leaves[to_index];
+                const auto n = from.count < to.count ? from.count : to.count;
+                if (to.kind == BinaryRawKind::Bytes) {
+                    memcpy(dst_image + to.offset, src_image + from.offset, n);
+                    continue;
+                }
+                for (size_t k = 0; k < n; ++k) {
+                    const auto s = src_image + from.offset + k * from.stride;
+                    const auto d = dst_image + to.offset + k * to.stride;
+                    if (from.kind == to.kind && to.valid == nullptr) {
+                        memcpy(d, s, _BinaryRawKindSize(to.kind));
+                        continue;
+                    }
+                    uint8_t scalar[8];
+                    if (from.kind == to.kind)
+                        memcpy(scalar, s, _BinaryRawKindSize(to.kind));
+                    else
+                        _ConvertBinaryRawScalar(from.kind, s, to.kind, scalar);
+                    if (to.valid != nullptr && !to.valid(scalar))
+                        return false;
+                    memcpy(d, scalar, _BinaryRawKindSize(to.kind));
+                }
+            }
+        }
+        return true;
+    }
+
+    // Skips the value after tag
+    void SkipValue(BinaryTag tag) {
+        switch (tag) {
+        case BinaryTag::Null:
+        case BinaryTag::False:
+        case BinaryTag::True:
+            return;
+        case BinaryTag::UInt:
+        case BinaryTag::Int:
+            ReadVarint();
+            return;
+        case BinaryTag::Float32:
+            _Take(4);
+            return;
+        case BinaryTag::Float64:
+            _Take(8);
+            return;
+        case BinaryTag::String:
+            ReadStringValue();
+            return;
+        case BinaryTag::Array:
+            for (auto n = ReadCount(); n > 0; --n)
+                SkipValue(ReadTag());
+            return;
+        case BinaryTag::Float32Array:
+            _Take(ReadCount() * 4);
+            return;
+        case BinaryTag::Float64Array:
+            _Take(ReadCount() * 8);
+            return;
+        case BinaryTag::Object:
+            for (auto n = ReadShape().names.size(); n > 0; --n)
+                SkipValue(ReadTag());
+            return;
+        case BinaryTag::Map:
+            for (auto n = ReadCount(); n > 0; --n) {
+                ReadStringValue();
+                SkipValue(ReadTag());
+            }
+            return;
+        case BinaryTag::Typed:
+            ReadTypeId();
+            SkipValue(ReadTag());
+            return;
+        case BinaryTag::Raw: {
+            const auto& raw_layout = _ReadRawLayout();
+            const auto count = ReadCount();
+            R_ASSERT(count <= static_cast<uint64_t>(end - p) / raw_layout.layout.size);
+            _Take(static_cast<uint64_t>(count) * raw_layout.layout.size);
+            return;
+        }
+        }
+        R_ASSERT(false);
+    }
+
+private:
+    RawLayout& _ReadRawLayout() {
+        const auto ref = ReadVarint();
+        if (ref != 0) {
+            R_ASSERT(ref <= raw_layouts.size());
+            return raw_layouts[ref - 1];
+        }
+        auto& layout = raw_layouts.emplace_back().layout;
+        _BinaryCopyLittleEndian(&layout.hash, _Take(8), 8, 1);
+        layout.size = static_cast<size_t>(ReadVarint());
+        R_ASSERT(layout.size > 0);
+        const auto count = ReadCount();
+        layout.leaves.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            BinaryRawLeaf leaf;
+            leaf.path = ReadStringValue();
+            leaf.offset = static_cast<size_t>(ReadVarint());
+            const auto kind = *_Take(1);
+            R_ASSERT(kind <= static_cast<uint8_t>(BinaryRawKind::Bytes));
+            leaf.kind = static_cast<BinaryRawKind>(kind);
+            leaf.count = static_cast<size_t>(ReadVarint());
+            leaf.stride = static_cast<size_t>(ReadVarint());
+            // Leaves must lie in the image
+            const auto kind_size = _BinaryRawKindSize(leaf.kind);
+            const bool inside = leaf.count == 0 ||
+                                (leaf.offset <= layout.size && leaf.stride <= layout.size && leaf.count <= layout.size &&
+                                 leaf.offset + (leaf.count - 1) * (leaf.kind == BinaryRawKind::Bytes ? 1 : leaf.stride) + kind_size <= layout.size);
+            R_ASSERT(inside);
+            layout.leaves.push_back(leaf);
+        }
+        return raw_layouts.back();
+    }
+
+    static const RawMatch& _MatchRaw(RawLayout& raw_layout, const BinaryRawLayout& to) {
+        for (const auto& match : raw_layout.matches) {
+            if (match.to == &to)
+                return match;
+        }
+        const auto& from = raw_layout.layout;
+        auto& match = raw_layout.matches.emplace_back();
+        match.to = &to;
+        match.identical = from.hash == to.hash && from.size == to.size;
+        if (match.identical) {
+            for (size_t i = 0; i < to.leaves.size(); ++i) {
+                if (to.leaves[i].valid != nullptr)
+                    match.checked.push_back(static_cast<uint32_t>(i));
+            }
+            return match;
+        }
+        std::vector<bool> written(from.leaves.size());
+        for (size_t i = 0; i < to.leaves.size(); ++i) {
+            const auto& leaf = to.leaves[i];
+            size_t j = 0;
+            for (; j < from.leaves.size(); ++j) {
+                if (!written[j] && from.leaves[j].path == leaf.path && (from.leaves[j].kind == BinaryRawKind::Bytes) == (leaf.kind == BinaryRawKind::Bytes))
+                    break;
+            }
+            if (j == from.leaves.size()) {
+                match.missing.push_back(leaf.path);
+                continue;
+            }
+            written[j] = true;
+            match.leaves.emplace_back(static_cast<uint32_t>(j), static_cast<uint32_t>(i));
+        }
+        for (size_t j = 0; j < from.leaves.size(); ++j) {
+            if (!written[j])
+                match.unknown.push_back(from.leaves[j].path);
+        }
+        return match;
+    }
+
+    const uint8_t* _Take(uint64_t n) {
+        R_ASSERT(n <= static_cast<uint64_t>(end - p));
+        const auto q = p;
+        p += n;
+        return q;
+    }
+
+    const uint8_t* p;
+    const uint8_t* end;
+    // Deques, as shapes are read while others are in use
+    std::deque<Shape> shapes;
+    std::deque<RawLayout> raw_layouts;
+    std::vector<uint32_t> type_ids;
+};
+
+}  // namespace reflection
@@ -0,0 +1,238 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <list>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <type_traits>
+#include <typeinfo>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "compare.h"
+#include "reflection.h"
+#include "soa.h"
+#include "util.h"
+
+// Deep copy of the fields declared for an interface. Bitwise comparable fields that are
+// contiguous are copied with one memcpy per run. Objects and container elements already
+// in the destination are reused where they have the right type, so that copying into the
+// same snapshot again mostly costs memory bandwidth.
+
+namespace reflection {
+
+// Other values: copy assignment where it exists, otherwise left as they are
+template <class I, class T, class Enable>
+class Cloning {
+public:
+    static void Clone(const T& src, T& dst, std::pmr::memory_resource*) {
+        if constexpr (std::is_copy_assignable_v<T>)
+            dst = src;
+    }
+};
+
+template <class I, class T>
+class Cloning<I, T, std::enable_if_t<IsBitwiseComparable<I, T>()>> {
+public:
+    static void Clone(const T& src, T& dst, std::pmr::memory_resource*) {
+        memcpy(&dst, &src, sizeof(T));
+    }
+};
+
+// Objects of a subclass of T are copied by the fields of their dynamic type,
+// which dst must be of too
+template <class I, class T>
+class Cloning<I, T, std::enable_if_t<HasFieldDeclarations<I, T>::value || std::is_base_of_v<I, T>>> {
+public:
+    static void Clone(const T& src, T& dst, std::pmr::memory_resource* resource) {
+        if constexpr (std::is_base_of_v<I, T>) {
+            if (!IsExactType(src)) {
+                const auto table = GetFieldTable<I>(src);
+                if (table.GetType() != PropertyType<I, T>::GetIPropertyType()) {
+                    R_ASSERT(typeid(src) == typeid(dst));
+                    table.GetType()->Clone(table.GetObject(), const_cast<void*>(GetFieldTable<I>(dst).GetObject()), resource);
+                    return;
+                }
+            }
+        }
+        if constexpr (HasFieldDeclarations<I, T>::value)
+            _Clone(src, dst, resource, std::make_index_sequence<Layout::kFieldCount>());
+    }
+
+private:
+    using Layout = FieldLayout<I, T>;
+
+    template <size_t... Ks>
+    static void _Clone(const T& src, T& dst, [[maybe_unused]] std::pmr::memory_resource* resource, std::index_sequence<Ks...>) {
+        const auto base_src = reinterpret_cast<const char*>(&src);
+        const auto base_dst = reinterpret_cast<char*>(&dst);
+        for (size_t i = 0; i < Layout::runs.count; ++i)
+            memcpy(base_dst + Layout::runs.spans[i].offset, base_src + Layout::runs.spans[i].offset, Layout::runs.spans[i].size);
+        (_CloneField<Ks>(src, dst, resource), ...);
+    }
+
+    template <size_t K>
+    static void _CloneField(const T& src, T& dst, std::pmr::memory_resource* resource) {
+        if constexpr (!Layout::template kBitwise<K>)
+            Cloning<I, typename Layout::template FieldType<K>>::Clone(Layout::template GetMember<K>(src), Layout::template GetMember<K>(dst), resource);
+    }
+};
+
+// Objects of registered subclasses are created with their factory
+template <class I, class _Ty, class _Dx>
+class Cloning<I, std::unique_ptr<_Ty, _Dx>> {
+public:
+    using ValueType = std::unique_ptr<_Ty, _Dx>;
+
+    static void Clone(const ValueType& src, ValueType& dst, std::pmr::memory_resource* resource) {
+        if (src == nullptr) {
+            dst.reset();
+            return;
+        }
+        if constexpr (std::is_polymorphic_v<_Ty>) {
+            if (dst != nullptr && typeid(*dst) != typeid(*src))
+                dst.reset();
+        }
+        if (dst == nullptr) {
+            resource = ResourceForDeleter<_Dx>(resource);
+            if constexpr (std::is_base_of_v<I, _Ty> && SubclassInfo<_Ty>::has) {
+                auto entry = SubclassInfo<_Ty>::GetFactoryTable().FindByType(typeid(*src));
+                if (entry != nullptr)
+                    ResetUniquePtr(dst, entry->factory(resource), resource, entry->size, entry->alignment);
+            }
+            if constexpr (!std::is_abstract_v<_Ty>) {
+                if (dst == nullptr)
+                    ResetUniquePtr(dst, CreateObject<_Ty>(resource), resource, sizeof(_Ty), alignof(_Ty));
+            }
+            if (dst == nullptr)
+                return;
+        }
+        Cloning<I, _Ty>::Clone(*src, *dst, resource);
+    }
+};
+
+template <class I, class T>
+struct _CloningRangeHelper {
+    template <class Range>
+    static void Clone(const Range& src, Range& dst, std::pmr::memory_resource* resource) {
+        auto itr = std::begin(dst);
+        for (const T& e : src)
+            Cloning<I, T>::Clone(e, *itr++, resource);
+    }
+};
+
+template <class I, class _Ty, size_t _Size>
+class Cloning<I, _Ty[_Size], std::enable_if_t<!IsBitwiseComparable<I, _Ty>()>> {
+public:
+    using ValueType = _Ty[_Size];
+
+    static void Clone(const ValueType& src, ValueType& dst, std::pmr::memory_resource* resource) {
+        _CloningRangeHelper<I, _Ty>::Clone(src, dst, resource);
+    }
+};
+
+template <class I, class _Ty, size_t _Size>
+class Cloning<I, std::array<_Ty, _Size>, std::enable_if_t<!IsBitwiseComparable<I, _Ty>()>> {
+public:
+    using ValueType = std::array<_Ty, _Size>;
+
+    static void Clone(const ValueType& src, ValueType& dst, std::pmr::memory_resource* resource) {
+        _CloningRangeHelper<I, _Ty>::Clone(src, dst, resource);
+    }
+};
+
+template <class I, template <class _Ty, class _Alloc> class ContainerType, class _Ty, class _Alloc>
+class Cloning<I, ContainerType<_Ty, _Alloc>, std::enable_if_t<std::is_same_v<ContainerType<_Ty, _Alloc>, std::vector<_Ty, _Alloc>> || std::is_same_v<ContainerType<_Ty, _Alloc>, std::list<_Ty, _Alloc>>>> {
+public:
+    using ValueType = ContainerType<_Ty, _Alloc>;
+
+    static void Clone(const ValueType& src, ValueType& dst, std::pmr::memory_resource* resource) {
+        if constexpr (std::is_same_v<ValueType, std::vector<_Ty, _Alloc>> && IsBitwiseComparable<I, _Ty>()) {
+            dst.assign(src.begin(), src.end());
+        } else {
+            dst.resize(src.size());
+            _CloningRangeHelper<I, _Ty>::Clone(src, dst, resource);
+        }
+    }
+};
+
+// Values of keys in both maps are copied in place
+template <class I, class T>
+struct _CloningMapHelper {
+    using _Ty = typename T::mapped_type;
+
+    static void Clone(const T& src, T& dst, std::pmr::memory_resource* resource) {
+        for (auto itr = dst.begin(); itr != dst.end();) {
+            if (src.find(itr->first) == src.end())
+                itr = dst.erase(itr);
+            else
+                ++itr;
+        }
+        for (const auto& [key, value] : src)
+            Cloning<I, _Ty>::Clone(value, dst[key], resource);
+    }
+};
+
+template <class I, template <class _Kty, class _Ty, class _Pr, class _Alloc> class ContainerType,
+          class _Kty, class _Ty, class _Pr, class _Alloc>
+class Cloning<I, ContainerType<_Kty, _Ty, _Pr, _Alloc>, std::enable_if_t<std::is_same_v<std::string, _Kty>>>
+    : public _CloningMapHelper<I, ContainerType<_Kty, _Ty, _Pr, _Alloc>> {
+};
+
+template <class I, template <class _Kty, class _Ty, class _Hasher, class _Keyeq, class _Alloc> class ContainerType,
+          class _Kty, class _Ty, class _Hasher, class _Keyeq, class _Alloc>
+class Cloning<I, ContainerType<_Kty, _Ty, _Hasher, _Keyeq, _Alloc>, std::enable_if_t<std::is_same_v<std::string, _Kty>>>
+    : public _CloningMapHelper<I, ContainerType<_Kty, _Ty, _Hasher, _Keyeq, _Alloc>> {
+};
+
+// Copied column by column, with one memcpy for bitwise comparable columns
+template <class I, class ColumnInterface, class T>
+class Cloning<I, SoaVector<ColumnInterface, T>> {
+public:
+    using ValueType = SoaVector<ColumnInterface, T>;
+
+    static void Clone(const ValueType& src, ValueType& dst, std::pmr::memory_resource* resource) {
+        dst.resize(src.size());
+        _Clone(src, dst, resource, std::make_index_sequence<ValueType::kColumnCount>());
+    }
+
+private:
+    template <size_t K>
+    static void _CloneColumn(const ValueType& src, ValueType& dst, std::pmr::memory_resource* resource) {
+        using M = typename ValueType::template ColumnType<K>;
+        const auto column_src = src.template Column<K>();
+        const auto column_dst = dst.template Column<K>();
+        if constexpr (IsBitwiseComparable<I, M>()) {
+            if (!src.empty())
+                memcpy(column_dst, column_src, src.size() * sizeof(M));
+        } else {
+            for (size_t i = 0; i < src.size(); ++i)
+                Cloning<I, M>::Clone(column_src[i], column_dst[i], resource);
+        }
+    }
+
+    template <size_t... Ks>
+    static void _Clone(const ValueType& src, ValueType& dst, std::pmr::memory_resource* resource, std::index_sequence<Ks...>) {
+        (_CloneColumn<Ks>(src, dst, resource), ...);
+    }
+};
+
+// Copies the fields of src declared for I into dst, following unique_ptr, containers and subclasses.
+// Objects created for unique_ptr with ResourceDeleter are allocated from resource.
+template <class I, class T>
+void CloneInto(const T& src, T& dst, std::pmr::memory_resource* resource = nullptr) {
+    Cloning<I, T>::Clone(src, dst, resource);
+}
+
+template <class I, class T>
+T Clone(const T& src, std::pmr::memory_resource* resource = nullptr) {
+    T dst{};
+    CloneInto<I>(src, dst, resource);
+    return dst;
+}
+
+}  // namespace reflection
@@ -0,0 +1,495 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <typeinfo>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "reflection.h"
+#include "soa.h"
+
+// Deep hashing and equality of the fields declared for an interface.
+// Values without padding are compared by representation, in bulk where fields are contiguous:
+// floating point values are equal when their bits are, so -0.0 != 0.0 and a NaN equals itself.
+// Hashes are stable within a process only.
+
+namespace reflection {
+
+inline uint64_t _MixHash(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    return h;
+}
+
+inline uint64_t HashCombine(uint64_t seed, uint64_t value) {
+    return _MixHash(seed ^ (value + 0x9E3779B97F4A7C15ull + (seed << 6) + (seed >> 2)));
+}
+
+// Hashes 8 bytes at a time
+inline uint64_t HashBytes(const void* data, size_t size, uint64_t seed) {
+    auto p = static_cast<const unsigned char*>(data);
+    uint64_t h = HashCombine(seed, size);
+    for (; size >= 8; p += 8, size -= 8) {
+        uint64_t word;
+        memcpy(&word, p, 8);
+        h = (h ^ word) * 0x9E3779B97F4A7C15ull;
+        h ^= h >> 29;
+    }
+    if (size > 0) {
+        uint64_t word = 0;
+        memcpy(&word, p, size);
+        h = (h ^ word) * 0x9E3779B97F4A7C15ull;
+    }
+    return _MixHash(h);
+}
+
+template <class T>
+struct _IsStdArray : std::false_type {};
+
+template <class T, size_t N>
+struct _IsStdArray<std::array<T, N>> : std::true_type {};
+
+// Trivially copyable references to strings, compared by the strings
+template <class T>
+constexpr bool _IsStringReference() {
+    return std::is_same_v<T, std::string_view> || std::is_same_v<T, const char*>;
+}
+
+// Specialized for values made of kCount values of Element and nothing else, such as glm
+// vectors (see compare_ext_glm.h), so that they are compared like arrays of Element.
+template <class T>
+struct PackedElements {
+    using Element = void;
+    static constexpr size_t kCount = 0;
+};
+
+// Values compared by representation: those the compiler knows to have no padding, floating
+// point numbers other than long double, and arrays and packed elements of them. Pointers are
+// not, so that images written and archived never hold addresses.
+template <class I, class T>
+constexpr bool IsBitwiseComparable() {
+    if constexpr (_IsStringReference<T>() || std::is_pointer_v<T> || std::is_member_pointer_v<T>)
+        return false;
+    else if constexpr (std::is_array_v<T>)
+        return IsBitwiseComparable<I, std::remove_extent_t<T>>();
+    else if constexpr (_IsStdArray<T>::value)
+        return IsBitwiseComparable<I, typename T::value_type>();
+    else if constexpr (!std::is_void_v<typename PackedElements<T>::Element>)
+        return std::is_trivially_copyable_v<T> && sizeof(T) == sizeof(typename PackedElements<T>::Element) * PackedElements<T>::kCount &&
+               IsBitwiseComparable<I, typename PackedElements<T>::Element>();
+    else if constexpr (HasFieldDeclarations<I, T>::value || std::is_base_of_v<I, T>)
+        return false;
+    else
+        return std::has_unique_object_representations_v<T> || (std::is_floating_point_v<T> && !std::is_same_v<T, long double>);
+}
+
+template <class T, class = void>
+struct _HasEqualOperator : std::false_type {};
+
+template <class T>
+struct _HasEqualOperator<T, std::void_t<decltype(std::declval<const T&>() == std::declval<const T&>())>> : std::true_type {};
+
+template <class T, class = void>
+struct _HasStdHash : std::false_type {};
+
+template <class T>
+struct _HasStdHash<T, std::void_t<decltype(std::hash<T>{}(std::declval<const T&>()))>> : std::true_type {};
+
+// Other values: operator== and std::hash where they exist.
+// Values without operator== compare unequal, so that changes to them are never missed.
+template <class I, class T, class Enable>
+class Comparison {
+public:
+    static uint64_t Hash(const T& v, uint64_t seed) {
+        if constexpr (_HasStdHash<T>::value)
+            return HashCombine(seed, std::hash<T>{}(v));
+        else
+            return seed;
+    }
+
+    static bool Equal(const T& a, const T& b) {
+        if constexpr (_HasEqualOperator<T>::value)
+            return static_cast<bool>(a == b);
+        else
+            return false;
+    }
+};
+
+template <class I, class T>
+class Comparison<I, T, std::enable_if_t<IsBitwiseComparable<I, T>()>> {
+public:
+    static uint64_t Hash(const T& v, uint64_t seed) {
+        return HashBytes(&v, sizeof(T), seed);
+    }
+
+    static bool Equal(const T& a, const T& b) {
+        return memcmp(&a, &b, sizeof(T)) == 0;
+    }
+};
+
+template <class I>
+class Comparison<I, std::string> {
+public:
+    static uint64_t Hash(const std::string& v, uint64_t seed) {
+        return HashBytes(v.data(), v.size(), seed);
+    }
+
+    static bool Equal(const std::string& a, const std::string& b) {
+        return a == b;
+    }
+};
+
+template <class I>
+class Comparison<I, std::string_view> {
+public:
+    static uint64_t Hash(std::string_view v, uint64_t seed) {
+        return HashBytes(v.data(), v.size(), seed);
+    }
+
+    static bool Equal(std::string_view a, std::string_view b) {
+        return a == b;
+    }
+};
+
+// nullptr differs from ""
+template <class I>
+class Comparison<I, const char*> {
+public:
+    static uint64_t Hash(const char* v, uint64_t seed) {
+        if (v == nullptr)
+            return HashCombine(seed, 0);
+        return HashBytes(v, strlen(v), HashCombine(seed, 1));
+    }
+
+    static bool Equal(const char* a, const char* b) {
+        if (a == nullptr || b == nullptr)
+            return a == b;
+        return strcmp(a, b) == 0;
+    }
+};
+
+// Fields of T declared for I in name order, with the bitwise comparable ones merged
+// into runs of contiguous bytes
+template <class I, class T>
+struct FieldLayout {
+    using Declarations = FieldDeclarationsOf<I, T>;
+
+    static constexpr size_t kFieldCount = Declarations::order.size();
+
+    template <size_t K>
+    using FieldType = typename std::tuple_element_t<Declarations::order[K], std::remove_const_t<decltype(Declarations::declarations)>>::ValueType;
+
+    template <size_t K>
+    static constexpr size_t kOffset = std::get<Declarations::order[K]>(Declarations::declarations).offset;
+
+    // Fields of classes that are not standard-layout have no offset, so they form no runs
+    template <size_t K>
+    static constexpr bool kBitwise = std::is_standard_layout_v<T> && IsBitwiseComparable<I, FieldType<K>>();
+
+    struct Span {
+        size_t offset;
+        size_t size;
+    };
+
+    struct Runs {
+        std::array<Span, kFieldCount> spans{};
+        size_t count = 0;
+    };
+
+    template <size_t... Ks>
+    static constexpr Runs MakeRuns(std::index_sequence<Ks...>) {
+        std::array<Span, kFieldCount> spans{};
+        size_t n = 0;
+        ((kBitwise<Ks> ? (void)(spans[n++] = Span{kOffset<Ks>, sizeof(FieldType<Ks>)}) : void()), ...);
+        for (size_t i = 1; i < n; ++i) {
+            const auto span = spans[i];
+            size_t j = i;
+            for (; j > 0 && span.offset < spans[j - 1].offset; --j)
+                spans[j] = spans[j - 1];
+            spans[j] = span;
+        }
+        Runs runs;
+        for (size_t i = 0; i < n; ++i) {
+            if (runs.count > 0 && runs.spans[runs.count - 1].offset + runs.spans[runs.count - 1].size == spans[i].offset)
+                runs.spans[runs.count - 1].size += spans[i].size;
+            else
+                runs.spans[runs.count++] = spans[i];
+        }
+        return runs;
+    }
+
+    static constexpr Runs runs = MakeRuns(std::make_index_sequence<kFieldCount>());
+
+    template <size_t K>
+    static const FieldType<K>& GetMember(const T& v) {
+        return GetMember<K>(const_cast<T&>(v));
+    }
+
+    template <size_t K>
+    static FieldType<K>& GetMember(T& v) {
+        return *static_cast<FieldType<K>*>(std::get<Declarations::order[K]>(Declarations::declarations).GetAddress(&v));
+    }
+};
+
+// Objects of a subclass of T are compared by the fields of their dynamic type
+template <class I, class T>
+class Comparison<I, T, std::enable_if_t<HasFieldDeclarations<I, T>::value || std::is_base_of_v<I, T>>> {
+public:
+    static uint64_t Hash(const T& v, uint64_t seed) {
+        if constexpr (std::is_base_of_v<I, T>) {
+            if (!IsExactType(v)) {
+                const auto table = GetFieldTable<I>(v);
+                if (table.GetType() != PropertyType<I, T>::GetIPropertyType())
+                    return table.GetType()->Hash(table.GetObject(), seed);
+            }
+        }
+        if constexpr (HasFieldDeclarations<I, T>::value) {
+            return _Hash(v, seed, std::make_index_sequence<Layout::kFieldCount>());
+        } else {
+            return seed;
+        }
+    }
+
+    static bool Equal(const T& a, const T& b) {
+        if constexpr (std::is_base_of_v<I, T>) {
+            if (typeid(a) != typeid(b))
+                return false;
+            if (!IsExactType(a)) {
+                const auto table_a = GetFieldTable<I>(a);
+                if (table_a.GetType() != PropertyType<I, T>::GetIPropertyType())
+                    return table_a.GetType()->Equal(table_a.GetObject(), GetFieldTable<I>(b).GetObject());
+            }
+        }
+        if constexpr (HasFieldDeclarations<I, T>::value) {
+            return _Equal(a, b, std::make_index_sequence<Layout::kFieldCount>());
+        } else {
+            return true;
+        }
+    }
+
+private:
+    using Layout = FieldLayout<I, T>;
+
+    template <size_t... Ks>
+    static uint64_t _Hash(const T& v, uint64_t seed, std::index_sequence<Ks...>) {
+        const auto base = reinterpret_cast<const char*>(&v);
+        for (size_t i = 0; i < Layout::runs.count; ++i)
+            seed = HashBytes(base + Layout::runs.spans[i].offset, Layout::runs.spans[i].size, seed);
+        ((seed = Layout::template kBitwise<Ks> ? seed : Comparison<I, typename Layout::template FieldType<Ks>>::Hash(Layout::template GetMember<Ks>(v), seed)), ...);
+        return seed;
+    }
+
+    template <size_t... Ks>
+    static bool _Equal(const T& a, const T& b, std::index_sequence<Ks...>) {
+        const auto base_a = reinterpret_cast<const char*>(&a);
+        const auto base_b = reinterpret_cast<const char*>(&b);
+        for (size_t i = 0; i < Layout::runs.count; ++i)
+            if (memcmp(base_a + Layout::runs.spans[i].offset, base_b + Layout::runs.spans[i].offset, Layout::runs.spans[i].size) != 0)
+                return false;
+        return ((Layout::template kBitwise<Ks> || Comparison<I, typename Layout::template FieldType<Ks>>::Equal(Layout::template GetMember<Ks>(a), Layout::template GetMember<Ks>(b))) && ...);
+    }
+};
+
+template <class I, class _Ty, class _Dx>
+class Comparison<I, std::unique_ptr<_Ty, _Dx>> {
+public:
+    using ValueType = std::unique_ptr<_Ty, _Dx>;
+
+    static uint64_t Hash(const ValueType& v, uint64_t seed) {
+        if (v == nullptr)
+            return HashCombine(seed, 0);
+        return Comparison<I, _Ty>::Hash(*v, HashCombine(seed, 1));
+    }
+
+    static bool Equal(const ValueType& a, const ValueType& b) {
+        if (a == nullptr || b == nullptr)
+            return a == b;
+        return Comparison<I, _Ty>::Equal(*a, *b);
+    }
+};
+
+template <class I, class T>
+struct _ComparisonRangeHelper {
+    template <class Range>
+    static uint64_t Hash(const Range& v, uint64_t seed) {
+        seed = HashCombine(seed, std::size(v));
+        for (const T& e : v)
+            seed = Comparison<I, T>::Hash(e, seed);
+        return seed;
+    }
+
+    template <class Range>
+    static bool Equal(const Range& a, const Range& b) {
+        if (std::size(a) != std::size(b))
+            return false;
+        auto itr = std::begin(b);
+        for (const T& e : a)
+            if (!Comparison<I, T>::Equal(e, *itr++))
+                return false;
+        return true;
+    }
+};
+
+template <class I, class _Ty, size_t _Size>
+class Comparison<I, _Ty[_Size], std::enable_if_t<!IsBitwiseComparable<I, _Ty>()>> {
+public:
+    using ValueType = _Ty[_Size];
+
+    static uint64_t Hash(const ValueType& v, uint64_t seed) {
+        return _ComparisonRangeHelper<I, _Ty>::Hash(v, seed);
+    }
+
+    static bool Equal(const ValueType& a, const ValueType& b) {
+        return _ComparisonRangeHelper<I, _Ty>::Equal(a, b);
+    }
+};
+
+template <class I, class _Ty, size_t _Size>
+class Comparison<I, std::array<_Ty, _Size>, std::enable_if_t<!IsBitwiseComparable<I, _Ty>()>> {
+public:
+    using ValueType = std::array<_Ty, _Size>;
+
+    static uint64_t Hash(const ValueType& v, uint64_t seed) {
+        return _ComparisonRangeHelper<I, _Ty>::Hash(v, seed);
+    }
+
+    static bool Equal(const ValueType& a, const ValueType& b) {
+        return _ComparisonRangeHelper<I, _Ty>::Equal(a, b);
+    }
+};
+
+template <class I, template <class _Ty, class _Alloc> class ContainerType, class _Ty, class _Alloc>
+class Comparison<I, ContainerType<_Ty, _Alloc>, std::enable_if_t<std::is_same_v<ContainerType<_Ty, _Alloc>, std::vector<_Ty, _Alloc>> || std::is_same_v<ContainerType<_Ty, _Alloc>, std::list<_Ty, _Alloc>>>> {
+public:
+    using ValueType = ContainerType<_Ty, _Alloc>;
+
+    // Elements of a vector are contiguous
+    static constexpr bool kBulk = std::is_same_v<ValueType, std::vector<_Ty, _Alloc>> && !std::is_same_v<_Ty, bool> && IsBitwiseComparable<I, _Ty>();
+
+    static uint64_t Hash(const ValueType& v, uint64_t seed) {
+        if constexpr (kBulk)
+            return HashBytes(v.data(), v.size() * sizeof(_Ty), seed);
+        else
+            return _ComparisonRangeHelper<I, _Ty>::Hash(v, seed);
+    }
+
+    static bool Equal(const ValueType& a, const ValueType& b) {
+        if constexpr (kBulk)
+            return a.size() == b.size() && (a.empty() || memcmp(a.data(), b.data(), a.size() * sizeof(_Ty)) == 0);
+        else
+            return _ComparisonRangeHelper<I, _Ty>::Equal(a, b);
+    }
+};
+
+// Independent of the order of elements, which unordered maps do not keep
+template <class I, class T>
+struct _ComparisonMapHelper {
+    using _Ty = typename T::mapped_type;
+
+    static uint64_t Hash(const T& v, uint64_t seed) {
+        uint64_t sum = 0;
+        for (const auto& [key, value] : v)
+            sum += Comparison<I, _Ty>::Hash(value, HashBytes(key.data(), key.size(), 0));
+        return HashCombine(HashCombine(seed, v.size()), sum);
+    }
+
+    static bool Equal(const T& a, const T& b) {
+        if (a.size() != b.size())
+            return false;
+        for (const auto& [key, value] : a) {
+            const auto itr = b.find(key);
+            if (itr == b.end() || !Comparison<I, _Ty>::Equal(value, itr->second))
+                return false;
+        }
+        return true;
+    }
+};
+
+template <class I, template <class _Kty, class _Ty, class _Pr, class _Alloc> class ContainerType,
+          class _Kty, class _Ty, class _Pr, class _Alloc>
+class Comparison<I, ContainerType<_Kty, _Ty, _Pr, _Alloc>, std::enable_if_t<std::is_same_v<std::string, _Kty>>>
+    : public _ComparisonMapHelper<I, ContainerType<_Kty, _Ty, _Pr, _Alloc>> {
+};
+
+template <class I, template <class _Kty, class _Ty, class _Hasher, class _Keyeq, class _Alloc> class ContainerType,
+          class _Kty, class _Ty, class _Hasher, class _Keyeq, class _Alloc>
+class Comparison<I, ContainerType<_Kty, _Ty, _Hasher, _Keyeq, _Alloc>, std::enable_if_t<std::is_same_v<std::string, _Kty>>>
+    : public _ComparisonMapHelper<I, ContainerType<_Kty, _Ty, _Hasher, _Keyeq, _Alloc>> {
+};
+
+// Compared column by column, in bulk for bitwise comparable columns
+template <class I, class ColumnInterface, class T>
+class Comparison<I, SoaVector<ColumnInterface, T>> {
+public:
+    using ValueType = SoaVector<ColumnInterface, T>;
+
+    static uint64_t Hash(const ValueType& v, uint64_t seed) {
+        return _Hash(v, HashCombine(seed, v.size()), std::make_index_sequence<ValueType::kColumnCount>());
+    }
+
+    static bool Equal(const ValueType& a, const ValueType& b) {
+        return a.size() == b.size() && _Equal(a, b, std::make_index_sequence<ValueType::kColumnCount>());
+    }
+
+private:
+    template <size_t K>
+    static uint64_t _HashColumn(const ValueType& v, uint64_t seed) {
+        using M = typename ValueType::template ColumnType<K>;
+        const auto column = v.template Column<K>();
+        if constexpr (IsBitwiseComparable<I, M>())
+            return HashBytes(column, v.size() * sizeof(M), seed);
+        for (size_t i = 0; i < v.size(); ++i)
+            seed = Comparison<I, M>::Hash(column[i], seed);
+        return seed;
+    }
+
+    template <size_t K>
+    static bool _EqualColumn(const ValueType& a, const ValueType& b) {
+        using M = typename ValueType::template ColumnType<K>;
+        const auto column_a = a.template Column<K>();
+        const auto column_b = b.template Column<K>();
+        if constexpr (IsBitwiseComparable<I, M>())
+            return a.empty() || memcmp(column_a, column_b, a.size() * sizeof(M)) == 0;
+        for (size_t i = 0; i < a.size(); ++i)
+            if (!Comparison<I, M>::Equal(column_a[i], column_b[i]))
+                return false;
+        return true;
+    }
+
+    template <size_t... Ks>
+    static uint64_t _Hash(const ValueType& v, uint64_t seed, std::index_sequence<Ks...>) {
+        ((seed = _HashColumn<Ks>(v, seed)), ...);
+        return seed;
+    }
+
+    template <size_t... Ks>
+    static bool _Equal(const ValueType& a, const ValueType& b, std::index_sequence<Ks...>) {
+        return (_EqualColumn<Ks>(a, b) && ...);
+    }
+};
+
+// Deep hash of the fields of object declared for I, following unique_ptr, containers and subclasses
+template <class I, class T>
+uint64_t Hash(const T& object, uint64_t seed = 0) {
+    return Comparison<I, T>::Hash(object, seed);
+}
+
+// Deep equality of the fields of a and b declared for I, following unique_ptr, containers and subclasses
+template <class I, class T>
+bool Equal(const T& a, const T& b) {
+    return Comparison<I, T>::Equal(a, b);
+}
+
+}  // namespace reflection
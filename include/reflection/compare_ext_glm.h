@@ -0,0 +1,21 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "reflection.h"
+
+namespace reflection {
+
+template <glm::length_t L, typename T, glm::qualifier Q>
+struct PackedElements<glm::vec<L, T, Q>> {
+    using Element = T;
+    static constexpr size_t kCount = L;
+};
+
+template <glm::length_t C, glm::length_t R, typename T, glm::qualifier Q>
+struct PackedElements<glm::mat<C, R, T, Q>> {
+    using Element = typename glm::mat<C, R, T, Q>::col_type;
+    static constexpr size_t kCount = C;
+};
+
+}  // namespace reflection
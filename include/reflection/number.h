@@ -0,0 +1,105 @@
+#pragma once
+
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <system_error>
+
+// Number text of JSON outside of rapidjson: floats written with the shortest digits
+// that read back as the same float, and numbers parsed straight from the input text.
+
+namespace reflection {
+
+constexpr size_t kFloatTextSize = 32;
+
+// Writes the shortest text that reads back as f, with a fraction or an exponent as
+// rapidjson writes doubles. Returns the length, 0 for NaN and infinities.
+inline size_t FormatFloat(float f, char (&buffer)[kFloatTextSize]) {
+    if (!std::isfinite(f))
+        return 0;
+    auto end = std::to_chars(buffer, buffer + kFloatTextSize - 2, f).ptr;
+    bool integral = true;
+    for (auto p = buffer; p != end; ++p)
+        integral = integral && *p != '.' && *p != 'e';
+    if (integral) {
+        *end++ = '.';
+        *end++ = '0';
+    }
+    return static_cast<size_t>(end - buffer);
+}
+
+inline bool _IsJsonDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+inline const char* _SkipJsonWhitespace(const char* p) {
+    while (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')
+        ++p;
+    return p;
+}
+
+// End of the JSON number at the start of p, nullptr if there is none.
+// p must be terminated by a character that is not part of a number, such as '\0'.
+inline const char* _ScanJsonNumber(const char* p) {
+    if (*p == '-')
+        ++p;
+    if (*p == '0') {
+        ++p;
+    } else if (*p >= '1' && *p <= '9') {
+        while (_IsJsonDigit(*++p)) {
+        }
+    } else {
+        return nullptr;
+    }
+    if (*p == '.') {
+        if (!_IsJsonDigit(*++p))
+            return nullptr;
+        while (_IsJsonDigit(*++p)) {
+        }
+    }
+    if (*p == 'e' || *p == 'E') {
+        ++p;
+        if (*p == '+' || *p == '-')
+            ++p;
+        if (!_IsJsonDigit(*p))
+            return nullptr;
+        while (_IsJsonDigit(*++p)) {
+        }
+    }
+    return p;
+}
+
+// Parses the leading elements of a JSON array of numbers, with p just after its '['
+// or a ','. Stops at the end of the array, at capacity or before other values, always
+// after a ',' or before the ']' so that a parser can go on with the rest of the array.
+// Returns the number of values, and in p where it stopped. Values are parsed as doubles and
+// narrowed to T, as GetFloat of a rapidjson value does, so that floats read either way agree.
+template <class T>
+size_t ParseJsonNumbers(const char*& p, T* values, size_t capacity) {
+    size_t count = 0;
+    while (count < capacity) {
+        const auto first = _SkipJsonWhitespace(p);
+        const auto last = _ScanJsonNumber(first);
+        if (last == nullptr)
+            break;
+        double parsed;
+        const auto result = std::from_chars(first, last, parsed);
+        if (result.ec != std::errc() || result.ptr != last)
+            break;
+        const auto value = static_cast<T>(parsed);
+        const auto next = _SkipJsonWhitespace(last);
+        if (*next == ']') {
+            values[count++] = value;
+            p = next;
+            break;
+        }
+        // Trailing commas are left to the parser to reject
+        if (*next != ',' || *_SkipJsonWhitespace(next + 1) == ']')
+            break;
+        values[count++] = value;
+        p = next + 1;
+    }
+    return count;
+}
+
+}  // namespace reflection
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory_resource>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+// Parallel loops over tasks on plain threads, for serialization of large containers.
+
+namespace reflection {
+
+struct ParallelOptions {
+    // Threads including the calling one, the hardware concurrency if 0
+    unsigned threads = 0;
+    // Vectors, lists and maps with fewer elements are handled by the calling thread
+    size_t min_elements = 4096;
+    // Chunks of elements per thread, more balance the load better
+    size_t chunks_per_thread = 8;
+};
+
+// threads, or the hardware concurrency if 0
+inline unsigned GetThreadCount(unsigned threads) {
+    return threads != 0 ? threads : std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Runs task(i) for each i in [0, count) on up to threads threads, the calling thread
+// included, which take the tasks in order. If a thread cannot be started, the tasks are left
+// to those that were. After an exception no more tasks are started, and the one of the task
+// with the lowest index is rethrown.
+inline void ParallelFor(size_t count, unsigned threads, const std::function<void(size_t)>& task) {
+    if (count == 0)
+        return;
+    std::atomic<size_t> next{0};
+    std::atomic<bool> failed{false};
+    std::mutex mutex;
+    size_t error_index = count;
+    std::exception_ptr error;
+    const auto work = [&] {
+        for (;;) {
+            const auto i = next.fetch_add(1);
+            if (i >= count || failed.load())
+                return;
+            try {
+                task(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (i < error_index) {
+                    error_index = i;
+                    error = std::current_exception();
+                }
+                failed = true;
+            }
+        }
+    };
+    std::vector<std::thread> workers;
+    const auto extra = std::min<size_t>(GetThreadCount(threads), count) - 1;
+    workers.reserve(extra);
+    for (size_t i = 0; i < extra; ++i) {
+        try {
+            workers.emplace_back(work);
+        } catch (const std::system_error&) {
+            break;
+        }
+    }
+    work();
+    for (auto& worker : workers)
+        worker.join();
+    if (error)
+        std::rethrow_exception(error);
+}
+
+// Memory resource that makes the calls to another one at a time, so that threads can share it
+class LockedResource final : public std::pmr::memory_resource {
+public:
+    explicit LockedResource(std::pmr::memory_resource* upstream) : upstream(upstream) {
+    }
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        return upstream->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        upstream->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+    std::pmr::memory_resource* upstream;
+    std::mutex mutex;
+};
+
+}  // namespace reflection
@@ -0,0 +1,504 @@
+#pragma once
+
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <typeinfo>
+#include <unordered_map>
+#include <vector>
+
+#include "reflection.h"
+
+// Property paths address values below an object by name, e.g. "rectangle.w", "vec[3].r" or "map.key".
+// A path is compiled once into offsets and accessors, after which it resolves in O(depth)
+// without string work, except for the lookup of map keys.
+
+namespace reflection {
+
+template <class I>
+class PropertyPath;
+
+// Moves from a value to one of its children, then by offset into the child
+struct PropertyStep {
+    // Returns nullptr if the child does not exist
+    void* (*access)(void* addr, const PropertyStep& step) = nullptr;
+    size_t index = 0;
+    std::string key;
+    size_t offset = 0;
+    // Accessor of a field without offset
+    void* (*field)(void* object) = nullptr;
+};
+
+template <class I>
+struct PropertyRef {
+    void* address = nullptr;
+    const IType<I>* type = nullptr;
+    // Userdata of the last field on the path, nullptr if there is none
+    const UserdataBase* userdata = nullptr;
+    const IPropertyType<I>* property = nullptr;
+};
+
+// Operations on values of a type that need no interface of their own:
+// property paths, hashing and comparison
+template <class I>
+class IPropertyType {
+public:
+    // Adds to the path the way from a value of this type to its child of a key.
+    // Returns the type of the child, or nullptr if there is no such child.
+    virtual const IPropertyType* Compile(std::string_view, PropertyPath<I>&) const {
+        return nullptr;
+    }
+
+    virtual const IType<I>* GetIType() const = 0;
+
+    virtual uint64_t Hash(const void* addr, uint64_t seed) const = 0;
+
+    virtual bool Equal(const void* a, const void* b) const = 0;
+
+    virtual void Clone(const void* src, void* dst, std::pmr::memory_resource* resource) const = 0;
+
+    // Edits of containers, which return false or nullptr for other types
+
+    virtual bool Resize(void*, size_t) const {
+        return false;
+    }
+
+    // The value of a key, inserted if it does not exist
+    virtual PropertyRef<I> Emplace(void*, std::string_view) const {
+        return {};
+    }
+
+    virtual bool Erase(void*, std::string_view) const {
+        return false;
+    }
+};
+
+template <class I, class T>
+class PropertyTypeBase : public IPropertyType<I> {
+public:
+    using ValueType = T;
+
+    static constexpr const IPropertyType<I>* GetIPropertyType() {
+        return &instance;
+    }
+
+    const IType<I>* GetIType() const override {
+        return Type<I, T>::GetIType();
+    }
+
+    uint64_t Hash(const void* addr, uint64_t seed) const override {
+        return Comparison<I, T>::Hash(*static_cast<const T*>(addr), seed);
+    }
+
+    bool Equal(const void* a, const void* b) const override {
+        return Comparison<I, T>::Equal(*static_cast<const T*>(a), *static_cast<const T*>(b));
+    }
+
+    void Clone(const void* src, void* dst, std::pmr::memory_resource* resource) const override {
+        Cloning<I, T>::Clone(*static_cast<const T*>(src), *static_cast<T*>(dst), resource);
+    }
+
+protected:
+    constexpr PropertyTypeBase(){};
+
+private:
+    static const PropertyType<I, T> instance;
+};
+
+template <class I, class T>
+const PropertyType<I, T> PropertyTypeBase<I, T>::instance{};
+
+// Values without children
+template <class I, class T, class Enable>
+class PropertyType : public PropertyTypeBase<I, T> {
+};
+
+// Objects whose fields can be of a subclass: their fields are looked up for each dynamic type
+template <class I, class T>
+constexpr bool IsDynamicPropertyType() {
+    return std::is_base_of_v<I, T> && !std::is_final_v<T>;
+}
+
+inline bool ParsePropertyIndex(std::string_view key, size_t& index) {
+    const auto last = key.data() + key.size();
+    const auto result = std::from_chars(key.data(), last, index);
+    return !key.empty() && result.ec == std::errc() && result.ptr == last;
+}
+
+// Takes the next key from path: "name", ".name" or "[key]"
+inline bool _PopPropertyKey(std::string_view& path, std::string_view& key) {
+    if (path[0] == '[') {
+        const auto end = path.find(']');
+        if (end == std::string_view::npos)
+            return false;
+        key = path.substr(1, end - 1);
+        path.remove_prefix(end + 1);
+        return true;
+    }
+    if (path[0] == '.')
+        path.remove_prefix(1);
+    key = path.substr(0, path.find_first_of(".["));
+    path.remove_prefix(key.size());
+    return !key.empty();
+}
+
+// A property path compiled for one root type. Paths that go through a polymorphic
+// unique_ptr compile the rest of the path once for every dynamic type they meet,
+// so they must not be used by several threads at once.
+template <class I>
+class PropertyPath {
+public:
+    using FieldTable = typename IReflectionBase<I>::FieldTable;
+
+    template <class T>
+    static PropertyPath Compile(std::string_view path) {
+        PropertyPath result;
+        result.root_ = PropertyType<I, T>::GetIPropertyType();
+        result.valid_ = result._Compile(result.root_, path);
+        if constexpr (IsDynamicPropertyType<I, T>()) {
+            // For roots of a subclass of T
+            if (path.empty())
+                return result;
+            result.root_dynamic_ = _MakeDynamic<T>();
+            result.root_dynamic_->path = std::string(path);
+        }
+        return result;
+    }
+
+    // False if a name or index of the path does not exist in the types it goes through.
+    // Subclasses of the root type are not considered.
+    bool IsValid() const {
+        return valid_;
+    }
+
+    // Root must be of the type the path is compiled for, or of a subclass of it.
+    // Address is nullptr if the path does not resolve for this object,
+    // e.g. for an index out of range or an empty unique_ptr.
+    template <class Root>
+    PropertyRef<I> Resolve(Root& root) const {
+        using RootType = std::remove_cv_t<Root>;
+        if (PropertyType<I, RootType>::GetIPropertyType() != root_)
+            return {};
+        const auto addr = reinterpret_cast<char*>(const_cast<RootType*>(&root));
+        if constexpr (IsDynamicPropertyType<I, RootType>()) {
+            if (root_dynamic_ && !IsExactType(root))
+                return _ResolveDynamic(*root_dynamic_, addr);
+        }
+        return _Resolve(addr);
+    }
+
+    // nullptr if the path does not resolve for root or the value is not a V
+    template <class V, class Root>
+    V* Get(Root& root) const {
+        const auto ref = Resolve(root);
+        if (ref.property != PropertyType<I, std::remove_cv_t<V>>::GetIPropertyType())
+            return nullptr;
+        return static_cast<V*>(ref.address);
+    }
+
+    template <class Root, class V>
+    bool Set(Root& root, V value) const {
+        const auto p = Get<V>(root);
+        if (p != nullptr)
+            *p = std::move(value);
+        return p != nullptr;
+    }
+
+    // Used by PropertyType to compile paths
+
+    void AddOffset(size_t offset) {
+        if (steps_.empty())
+            offset_ += offset;
+        else
+            steps_.back().offset += offset;
+    }
+
+    void AddStep(PropertyStep step) {
+        steps_.push_back(std::move(step));
+    }
+
+    // Returns the type of the field, or nullptr if table has no field named key
+    const IPropertyType<I>* AddField(const FieldTable& table, std::string_view key) {
+        const auto field = table.Find(key);
+        if (field == nullptr)
+            return nullptr;
+        if (field->offset != kNoFieldOffset) {
+            AddOffset(field->offset);
+        } else {
+            PropertyStep step;
+            step.access = &_AccessField;
+            step.field = field->access;
+            AddStep(std::move(step));
+        }
+        userdata_ = field->userdata;
+        return field->property;
+    }
+
+    // The rest of the path is compiled when resolved, for the dynamic type of T
+    template <class T>
+    void SetDynamic() {
+        dynamic_ = _MakeDynamic<T>();
+    }
+
+private:
+    struct Dynamic {
+        struct Entry {
+            const std::type_info* type;
+            std::unique_ptr<PropertyPath> path;
+        };
+
+        const std::type_info& (*get_type)(const void*) = nullptr;
+        FieldTable (*get_table)(const void*) = nullptr;
+        std::string path;
+        mutable std::vector<Entry> cache;
+    };
+
+    static void* _AccessField(void* addr, const PropertyStep& step) {
+        return step.field(addr);
+    }
+
+    template <class T>
+    static std::unique_ptr<Dynamic> _MakeDynamic() {
+        auto dynamic = std::make_unique<Dynamic>();
+        dynamic->get_type = [](const void* addr) -> const std::type_info& {
+            return typeid(*static_cast<const T*>(addr));
+        };
+        dynamic->get_table = [](const void* addr) {
+            return static_cast<const T*>(addr)->GetFieldTable(static_cast<I*>(nullptr));
+        };
+        return dynamic;
+    }
+
+    PropertyRef<I> _Resolve(char* addr) const {
+        if (!valid_)
+            return {};
+        addr += offset_;
+        for (const auto& step : steps_) {
+            const auto child = step.access(addr, step);
+            if (child == nullptr)
+                return {};
+            addr = static_cast<char*>(child) + step.offset;
+        }
+        if (dynamic_)
+            return _ResolveDynamic(*dynamic_, addr);
+        return {addr, type_, userdata_, property_};
+    }
+
+    bool _Compile(const IPropertyType<I>* type, std::string_view path) {
+        while (!path.empty()) {
+            const auto rest = path;
+            std::string_view key;
+            if (!_PopPropertyKey(path, key))
+                return false;
+            type = type->Compile(key, *this);
+            if (type == nullptr)
+                return false;
+            if (dynamic_) {
+                dynamic_->path = std::string(rest);
+                return true;
+            }
+        }
+        type_ = type->GetIType();
+        property_ = type;
+        return true;
+    }
+
+    static PropertyRef<I> _ResolveDynamic(const Dynamic& dynamic, char* addr) {
+        const auto& type = dynamic.get_type(addr);
+        for (const auto& entry : dynamic.cache)
+            if (*entry.type == type)
+                return entry.path->_Resolve(addr);
+
+        // Fields are relative to the start of the dynamic type, which may differ from addr
+        const auto table = dynamic.get_table(addr);
+        auto tail = std::make_unique<PropertyPath>();
+        tail->offset_ = static_cast<const char*>(table.GetObject()) - addr;
+        std::string_view path = dynamic.path;
+        std::string_view key;
+        if (_PopPropertyKey(path, key)) {
+            const auto property = tail->AddField(table, key);
+            tail->valid_ = property != nullptr && tail->_Compile(property, path);
+        }
+        dynamic.cache.push_back({&type, std::move(tail)});
+        return dynamic.cache.back().path->_Resolve(addr);
+    }
+
+    const IPropertyType<I>* root_ = nullptr;
+    ptrdiff_t offset_ = 0;
+    std::vector<PropertyStep> steps_;
+    std::unique_ptr<Dynamic> dynamic_;
+    std::unique_ptr<Dynamic> root_dynamic_;
+    const IType<I>* type_ = nullptr;
+    const UserdataBase* userdata_ = nullptr;
+    const IPropertyType<I>* property_ = nullptr;
+    bool valid_ = false;
+};
+
+template <class I, class T>
+PropertyPath<I> CompilePropertyPath(std::string_view path) {
+    return PropertyPath<I>::template Compile<T>(path);
+}
+
+template <class I, class T>
+class PropertyType<I, T, std::enable_if_t<HasFieldDeclarations<I, T>::value>> : public PropertyTypeBase<I, T> {
+public:
+    const IPropertyType<I>* Compile(std::string_view key, PropertyPath<I>& path) const override {
+        using Table = FieldTableOf<I, T>;
+        return path.AddField(typename PropertyPath<I>::FieldTable(Table::fields, Table::index.GetView()), key);
+    }
+};
+
+template <class I, class _Ty, class _Dx>
+class PropertyType<I, std::unique_ptr<_Ty, _Dx>> : public PropertyTypeBase<I, std::unique_ptr<_Ty, _Dx>> {
+public:
+    using ValueType = std::unique_ptr<_Ty, _Dx>;
+
+    const IPropertyType<I>* Compile(std::string_view key, PropertyPath<I>& path) const override {
+        PropertyStep step;
+        step.access = &Access;
+        path.AddStep(std::move(step));
+        if constexpr (IsDynamicPropertyType<I, _Ty>()) {
+            // key is compiled along with the rest of the path
+            path.template SetDynamic<_Ty>();
+            return this;
+        } else {
+            return PropertyType<I, _Ty>::GetIPropertyType()->Compile(key, path);
+        }
+    }
+
+private:
+    static void* Access(void* addr, const PropertyStep&) {
+        return static_cast<ValueType*>(addr)->get();
+    }
+};
+
+template <class I, class _Ty, size_t _Size>
+struct _PropertyArrayTypeHelper {
+    static const IPropertyType<I>* Compile(std::string_view key, PropertyPath<I>& path) {
+        size_t index;
+        if (!ParsePropertyIndex(key, index) || index >= _Size)
+            return nullptr;
+        path.AddOffset(index * sizeof(_Ty));
+        return PropertyType<I, _Ty>::GetIPropertyType();
+    }
+};
+
+template <class I, class _Ty, size_t _Size>
+class PropertyType<I, _Ty[_Size]> : public PropertyTypeBase<I, _Ty[_Size]> {
+public:
+    const IPropertyType<I>* Compile(std::string_view key, PropertyPath<I>& path) const override {
+        return _PropertyArrayTypeHelper<I, _Ty, _Size>::Compile(key, path);
+    }
+};
+
+template <class I, class _Ty, size_t _Size>
+class PropertyType<I, std::array<_Ty, _Size>> : public PropertyTypeBase<I, std::array<_Ty, _Size>> {
+public:
+    const IPropertyType<I>* Compile(std::string_view key, PropertyPath<I>& path) const override {
+        return _PropertyArrayTypeHelper<I, _Ty, _Size>::Compile(key, path);
+    }
+};
+
+template <class I, template <class _Ty, class _Alloc> class ContainerType, class _Ty, class _Alloc>
+class PropertyType<I, ContainerType<_Ty, _Alloc>, std::enable_if_t<std::is_same_v<ContainerType<_Ty, _Alloc>, std::vector<_Ty, _Alloc>> || std::is_same_v<ContainerType<_Ty, _Alloc>, std::list<_Ty, _Alloc>>>>
+    : public PropertyTypeBase<I, ContainerType<_Ty, _Alloc>> {
+public:
+    using ValueType = ContainerType<_Ty, _Alloc>;
+
+    const IPropertyType<I>* Compile(std::string_view key, PropertyPath<I>& path) const override {
+        PropertyStep step;
+        step.access = &Access;
+        if (!ParsePropertyIndex(key, step.index))
+            return nullptr;
+        path.AddStep(std::move(step));
+        return PropertyType<I, _Ty>::GetIPropertyType();
+    }
+
+    bool Resize(void* addr, size_t size) const override {
+        static_cast<ValueType*>(addr)->resize(size);
+        return true;
+    }
+
+private:
+    static void* Access(void* addr, const PropertyStep& step) {
+        auto& v = *static_cast<ValueType*>(addr);
+        if (step.index >= v.size())
+            return nullptr;
+        return &*std::next(v.begin(), step.index);
+    }
+};
+
+template <class I, class T>
+struct _PropertyMapTypeHelper {
+    using ValueType = T;
+    using MappedType = typename T::mapped_type;
+
+    static const IPropertyType<I>* Compile(std::string_view key, PropertyPath<I>& path) {
+        PropertyStep step;
+        step.access = &Access;
+        step.key = std::string(key);
+        path.AddStep(std::move(step));
+        return PropertyType<I, MappedType>::GetIPropertyType();
+    }
+
+    static void* Access(void* addr, const PropertyStep& step) {
+        auto& v = *static_cast<ValueType*>(addr);
+        const auto itr = v.find(step.key);
+        return itr != v.end() ? &itr->second : nullptr;
+    }
+
+    static PropertyRef<I> Emplace(void* addr, std::string_view key) {
+        auto& value = (*static_cast<ValueType*>(addr))[std::string(key)];
+        const auto property = PropertyType<I, MappedType>::GetIPropertyType();
+        return {&value, property->GetIType(), nullptr, property};
+    }
+
+    static bool Erase(void* addr, std::string_view key) {
+        return static_cast<ValueType*>(addr)->erase(std::string(key)) != 0;
+    }
+};
+
+template <class I, template <class _Kty, class _Ty, class _Pr, class _Alloc> class ContainerType,
+          class _Kty, class _Ty, class _Pr, class _Alloc>
+class PropertyType<I, ContainerType<_Kty, _Ty, _Pr, _Alloc>, std::enable_if_t<std::is_same_v<std::string, _Kty>>>
+    : public PropertyTypeBase<I, ContainerType<_Kty, _Ty, _Pr, _Alloc>> {
+public:
+    const IPropertyType<I>* Compile(std::string_view key, PropertyPath<I>& path) const override {
+        return _PropertyMapTypeHelper<I, ContainerType<_Kty, _Ty, _Pr, _Alloc>>::Compile(key, path);
+    }
+
+    PropertyRef<I> Emplace(void* addr, std::string_view key) const override {
+        return _PropertyMapTypeHelper<I, ContainerType<_Kty, _Ty, _Pr, _Alloc>>::Emplace(addr, key);
+    }
+
+    bool Erase(void* addr, std::string_view key) const override {
+        return _PropertyMapTypeHelper<I, ContainerType<_Kty, _Ty, _Pr, _Alloc>>::Erase(addr, key);
+    }
+};
+
+template <class I, template <class _Kty, class _Ty, class _Hasher, class _Keyeq, class _Alloc> class ContainerType,
+          class _Kty, class _Ty, class _Hasher, class _Keyeq, class _Alloc>
+class PropertyType<I, ContainerType<_Kty, _Ty, _Hasher, _Keyeq, _Alloc>, std::enable_if_t<std::is_same_v<std::string, _Kty>>>
+    : public PropertyTypeBase<I, ContainerType<_Kty, _Ty, _Hasher, _Keyeq, _Alloc>> {
+public:
+    const IPropertyType<I>* Compile(std::string_view key, PropertyPath<I>& path) const override {
+        return _PropertyMapTypeHelper<I, ContainerType<_Kty, _Ty, _Hasher, _Keyeq, _Alloc>>::Compile(key, path);
+    }
+
+    PropertyRef<I> Emplace(void* addr, std::string_view key) const override {
+        return _PropertyMapTypeHelper<I, ContainerType<_Kty, _Ty, _Hasher, _Keyeq, _Alloc>>::Emplace(addr, key);
+    }
+
+    bool Erase(void* addr, std::string_view key) const override {
+        return _PropertyMapTypeHelper<I, ContainerType<_Kty, _Ty, _Hasher, _Keyeq, _Alloc>>::Erase(addr, key);
+    }
+};
+
+}  // namespace reflection
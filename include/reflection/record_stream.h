@@ -0,0 +1,194 @@
+#pragma once
+
+#include <rapidjson/reader.h>
+#include <rapidjson/writer.h>
+
+#include <cstddef>
+#include <iterator>
+#include <memory_resource>
+#include <optional>
+
+#include "serialization.h"
+#include "util.h"
+
+// Streams of records of one type in JSON text, read and written one record at a time
+// through rapidjson streams, so that memory does not grow with the number of records.
+// With FileReadStream or IStreamWrapper, input is read through their fixed-size buffers.
+
+namespace reflection {
+
+enum class RecordFormat {
+    // Newline-delimited JSON: one value per line, or values separated by any whitespace
+    Lines,
+    // Elements of one top-level array
+    Array,
+};
+
+// Deserializes the records of is, a rapidjson input stream, one by one. Malformed input
+// throws as Deserialize from a reader does.
+//   RecordReader<Shape, rapidjson::FileReadStream> records(stream);
+//   for (const auto& shape : records) ...
+template <class T, class InputStream, unsigned parseFlags = rapidjson::kParseDefaultFlags>
+class RecordReader {
+public:
+    // Input iterator over the records, each one deserialized into a new T
+    class iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = T*;
+        using reference = T&;
+
+        iterator() = default;
+
+        T& operator*() const {
+            return *records->record;
+        }
+
+        T* operator->() const {
+            return &*records->record;
+        }
+
+        iterator& operator++() {
+            records->record.emplace();
+            if (!records->Read(*records->record))
+                records = nullptr;
+            return *this;
+        }
+
+        bool operator==(const iterator& other) const {
+            return records == other.records;
+        }
+
+        bool operator!=(const iterator& other) const {
+            return records != other.records;
+        }
+
+    private:
+        friend class RecordReader;
+
+        explicit iterator(RecordReader* records) : records(records) {
+        }
+
+        RecordReader* records = nullptr;
+    };
+
+    explicit RecordReader(InputStream& is, RecordFormat format = RecordFormat::Lines, std::pmr::memory_resource* resource = nullptr)
+        : is(is), format(format), reader(is), context{resource} {
+        context.key_orders = &key_orders;
+    }
+
+    RecordReader(const RecordReader&) = delete;
+    RecordReader& operator=(const RecordReader&) = delete;
+
+    // Deserializes the next record into record, returns false at the end of the input
+    bool Read(T& record) {
+        if (format == RecordFormat::Lines) {
+            while (is.Peek() == ' ' || is.Peek() == '\n' || is.Peek() == '\r' || is.Peek() == '\t')
+                is.Take();
+            if (is.Peek() == '\0')
+                return false;
+            if (started)
+                reader.Restart();
+        } else {
+            if (!started) {
+                reader.Next();
+                R_ASSERT(reader.GetToken() == ISerializationReader::Token::StartArray);
+            }
+            if (finished)
+                return false;
+        }
+        started = true;
+        reader.Next();
+        if (format == RecordFormat::Array && reader.GetToken() == ISerializationReader::Token::EndArray) {
+            finished = true;
+            return false;
+        }
+        reflection::Deserialize(record, reader, context);
+        return true;
+    }
+
+    // Reads the first record, each record is valid until the iterator is incremented
+    iterator begin() {
+        return ++iterator(this);
+    }
+
+    iterator end() {
+        return iterator();
+    }
+
+    // Kept across records, e.g. for DeserializeContext::in_place. Its key order cache
+    // predicts the keys of each record from the one before.
+    DeserializeContext& GetContext() {
+        return context;
+    }
+
+private:
+    InputStream& is;
+    RecordFormat format;
+    SerializationReader<InputStream, parseFlags | rapidjson::kParseStopWhenDoneFlag> reader;
+    KeyOrderCache key_orders;
+    DeserializeContext context;
+    std::optional<T> record;
+    bool started = false;
+    bool finished = false;
+};
+
+// Serializes records one by one to os, a rapidjson output stream such as FileWriteStream or
+// OStreamWrapper, each in compact form on a line of its own
+template <class T, class OutputStream>
+class RecordWriter {
+public:
+    explicit RecordWriter(OutputStream& os, RecordFormat format = RecordFormat::Lines)
+        : os(os), format(format), writer(os) {
+    }
+
+    RecordWriter(const RecordWriter&) = delete;
+    RecordWriter& operator=(const RecordWriter&) = delete;
+
+    ~RecordWriter() {
+        Close();
+    }
+
+    void Write(const T& record) {
+        R_ASSERT(!closed);
+        if (format == RecordFormat::Array) {
+            os.Put(count == 0 ? '[' : ',');
+            os.Put('\n');
+        }
+        writer.Reset(os);
+        reflection::Serialize(record, writer);
+        if (format == RecordFormat::Lines)
+            os.Put('\n');
+        ++count;
+    }
+
+    // Ends the array and flushes os, also done by the destructor
+    void Close() {
+        if (closed)
+            return;
+        closed = true;
+        if (format == RecordFormat::Array) {
+            if (count == 0)
+                os.Put('[');
+            os.Put('\n');
+            os.Put(']');
+            os.Put('\n');
+        }
+        os.Flush();
+    }
+
+    size_t GetCount() const {
+        return count;
+    }
+
+private:
+    OutputStream& os;
+    RecordFormat format;
+    rapidjson::Writer<OutputStream> writer;
+    size_t count = 0;
+    bool closed = false;
+};
+
+}  // namespace reflection
@@ -1,55 +1,74 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <map>
+#include <memory>
+#include <memory_resource>
+#include <new>
 #include <string>
+#include <string_view>
+#include <tuple>
 #include <type_traits>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+// Field tables are built at compile time: field names must be string literals and
+// Userdata must be literal types. Fields of standard-layout classes are accessed by offset
+// from the object start, fields of other classes through an accessor function, which
+// offsetof does not support. Fields of base classes are included.
+
+#define REFLECTION_FIELD_OFFSET(Class, field)                  \
+    [] {                                                       \
+        if constexpr (std::is_standard_layout_v<Class>)        \
+            return offsetof(Class, field);                     \
+        else                                                   \
+            return reflection::kNoFieldOffset;                 \
+    }()
+#define REFLECTION_FIELD_ACCESS(Class, field) \
+    [](void* object) -> void* { return std::addressof(static_cast<Class*>(object)->field); }
 
 // Declare in class definition
-#define FIELD_DECLARATION_BEGIN(interfacename)                                   \
-    const reflection::IReflectionBase<interfacename>::FieldTable& GetFieldTable( \
-        interfacename* = nullptr) const override {                               \
-        using Class = std::decay_t<decltype(*this)>;                             \
-        using InterfaceType = interfacename;                                     \
-        static reflection::IReflectionBase<InterfaceType>::FieldTable m {
+#define FIELD_DECLARATION_BEGIN(interfacename)                            \
+    reflection::IReflectionBase<interfacename>::FieldTable GetFieldTable( \
+        interfacename* = nullptr) const override {                        \
+        return reflection::GetFlattenedFieldTable<interfacename>(this);   \
+    }                                                                     \
+    template <class Class>                                                \
+    static constexpr auto GetFieldDeclarations(interfacename*) {          \
+        using InterfaceType [[maybe_unused]] = interfacename;             \
+        constexpr auto declarations = std::make_tuple(
 #define FIELD_DECLARATION(name, field, ...) \
-    {name, [](InterfaceType* arg) {                                              \
-        auto p = static_cast<Class*>(arg);                                        \
-        using T = decltype(p->field);                                             \
-        static reflection::Type<InterfaceType, T>::Userdata d;                    \
-        __VA_ARGS__;                                                              \
-        return reflection::IReflectionBase<InterfaceType>::FieldInfo {            \
-            static_cast<void*>(&(p->field)),                                      \
-            reflection::Type<InterfaceType, T>::GetIType(),                       \
-            static_cast<reflection::UserdataBase*>(&d) }; }},
-
-#define FIELD_DECLARATION_END_WITH_BASE_CLASS(BaseClass) \
-    }                                                    \
-    ;                                                    \
-    static bool initialized = false;                     \
-    if (!initialized) {                                  \
-        const auto& base = BaseClass::GetFieldTable(     \
-            static_cast<InterfaceType*>(nullptr));       \
-        m.insert(base.begin(), base.end());              \
-        initialized = true;                              \
-    }                                                    \
-    return m;                                            \
-    }
-
-#define FIELD_DECLARATION_END() \
-    }                           \
-    ;                           \
-    return m;                   \
+    reflection::MakeFieldDeclaration<InterfaceType, decltype(std::declval<Class&>().field)>( \
+        name, REFLECTION_FIELD_OFFSET(Class, field), REFLECTION_FIELD_ACCESS(Class, field), []([[maybe_unused]] auto& d) { __VA_ARGS__; }),
+
+// Fields of the base class are declared again with offsets relative to the derived class
+#define FIELD_DECLARATION_END_WITH_BASE_CLASS(BaseClass)                                        \
+    reflection::FieldDeclarationEnd{});                                                         \
+    static_assert(reflection::HasUniqueFieldNames(declarations), "Duplicate field name");       \
+    return std::tuple_cat(                                                                      \
+        reflection::DropFieldDeclarationEnd(declarations),                                      \
+        BaseClass::template GetFieldDeclarations<Class>(static_cast<InterfaceType*>(nullptr))); \
+    }
+
+#define FIELD_DECLARATION_END()                                                           \
+    reflection::FieldDeclarationEnd{});                                                   \
+    static_assert(reflection::HasUniqueFieldNames(declarations), "Duplicate field name"); \
+    return declarations;                                                                  \
     }
 
 // Declare in base class header file (after class definition)
-#define HAS_SUBCLASS(classname)                                  \
-    template <>                                                  \
-    struct reflection::SubclassInfo<classname> {                 \
-        using Class = classname;                                 \
-        using FactoryFunc = Class* (*)();                        \
-        using FactoryTable = std::map<std::string, FactoryFunc>; \
-        static constexpr bool has = true;                        \
-        static const FactoryTable& GetFactoryTable();            \
+#define HAS_SUBCLASS(classname)                                \
+    template <>                                                \
+    struct reflection::SubclassInfo<classname> {               \
+        using Class = classname;                               \
+        using FactoryTable = reflection::SubclassTable<Class>; \
+        using FactoryFunc = FactoryTable::FactoryFunc;         \
+        static constexpr bool has = true;                      \
+        static const FactoryTable& GetFactoryTable();          \
     };
 
 // Declare in base class cpp file
@@ -57,76 +76,302 @@
 #define SUBCLASS_DECLARATION_BEGIN(classname)                \
     const reflection::SubclassInfo<classname>::FactoryTable& \
     reflection::SubclassInfo<classname>::GetFactoryTable() { \
-        static const FactoryTable m {
-#define SUBCLASS_DECLARATION(subclass) \
-    {typeid(subclass).name(), []() { return static_cast<Class*>(new subclass()); }},
+        using Entry = FactoryTable::Entry;                   \
+        static constexpr Entry entries[] = {
+#define SUBCLASS_DECLARATION(subclass) SUBCLASS_DECLARATION_NAMED(subclass, #subclass)
+
+// The name is written to documents through its hash: keep it once documents exist
+#define SUBCLASS_DECLARATION_NAMED(subclass, name)                                   \
+    Entry{name, reflection::HashTypeName(name), sizeof(subclass), alignof(subclass), \
+          []() -> const std::type_info& { return typeid(subclass); },                \
+          [](std::pmr::memory_resource* resource) {                                  \
+              return static_cast<Class*>(reflection::CreateObject<subclass>(resource)); }},
 
-#define SUBCLASS_DECLARATION_END() \
-    }                              \
-    ;                              \
-    return m;                      \
+#define SUBCLASS_DECLARATION_END()                                                      \
+    Entry{}                                                                             \
+    }                                                                                   \
+    ;                                                                                   \
+    static_assert(reflection::HasUniqueTypeIds(entries), "Duplicate subclass type id"); \
+    static const FactoryTable m(entries);                                               \
+    return m;                                                                           \
     }
 
 // Declare in struct header file (after struct definition)
-#define STRUCT_FIELD_DECLARATION_BEGIN(structname, interfacename)                \
-    template <>                                                                  \
-    struct reflection::IsReflectableStruct<interfacename, structname> {          \
-        static constexpr bool value = true;                                      \
-    };                                                                           \
-    template <>                                                                  \
-    inline const auto& reflection::GetFieldTable(                                \
-        const structname& object, interfacename*) {                              \
-        using Class = structname;                                                \
-        using InterfaceType = interfacename;                                     \
-        using FieldInfo = reflection::IReflectionBase<InterfaceType>::FieldInfo; \
-        using GetFieldFunc = FieldInfo (*)(Class*);                              \
-        static std::map<std::string, GetFieldFunc> m {
+#define STRUCT_FIELD_DECLARATION_BEGIN(structname, interfacename)       \
+    template <>                                                         \
+    struct reflection::IsReflectableStruct<interfacename, structname> { \
+        static constexpr bool value = true;                             \
+        template <class Class>                                          \
+        static constexpr auto GetFieldDeclarations(interfacename*) {    \
+            using InterfaceType [[maybe_unused]] = interfacename;       \
+            constexpr auto declarations = std::make_tuple(
 #define STRUCT_FIELD_DECLARATION(name, field, ...) \
-    {name, [](Class* p) {                                            \
-        using T = decltype(p->field);                                 \
-        static reflection::Type<InterfaceType, T>::Userdata d;        \
-        __VA_ARGS__;                                                  \
-        return FieldInfo {                                            \
-            static_cast<void*>(&(p->field)),                          \
-            reflection::Type<InterfaceType, T>::GetIType(),           \
-            static_cast<reflection::UserdataBase*>(&d) }; }},
+    reflection::MakeFieldDeclaration<InterfaceType, decltype(std::declval<Class&>().field)>( \
+        name, REFLECTION_FIELD_OFFSET(Class, field), REFLECTION_FIELD_ACCESS(Class, field), []([[maybe_unused]] auto& d) { __VA_ARGS__; }),
 
-#define STRUCT_FIELD_DECLARATION_END() \
-    }                                  \
-    ;                                  \
-    return m;                          \
-    }
+#define STRUCT_FIELD_DECLARATION_END()                                                    \
+    reflection::FieldDeclarationEnd{});                                                   \
+    static_assert(reflection::HasUniqueFieldNames(declarations), "Duplicate field name"); \
+    return declarations;                                                                  \
+    }                                                                                     \
+    };
 
 namespace reflection {
 
+// Offset of the fields of classes that are not standard-layout
+constexpr size_t kNoFieldOffset = SIZE_MAX;
+
 template <class I>
 class IType;
 
+template <class I>
+class IPropertyType;
+
+template <class I, class T, class Enable = void>
+class PropertyType;
+
+template <class I, class T, class Enable = void>
+class Comparison;
+
+template <class I, class T, class Enable = void>
+class Cloning;
+
 struct UserdataBase {};
 
+constexpr uint64_t HashFieldName(std::string_view name) {
+    uint64_t h = 14695981039346656037ull;
+    for (char c : name) {
+        h ^= static_cast<unsigned char>(c);
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+constexpr size_t _CeilPow2(size_t n) {
+    size_t p = 1;
+    while (p < n)
+        p <<= 1;
+    return p;
+}
+
+constexpr uint32_t _FieldIndexBucket(uint64_t hash, uint32_t bucket_mask) {
+    return static_cast<uint32_t>((hash * 0x9E3779B97F4A7C15ull) >> 32) & bucket_mask;
+}
+
+constexpr uint32_t _FieldIndexSlot(uint64_t hash, uint32_t displacement, uint32_t slot_mask) {
+    uint64_t x = hash + displacement * 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return static_cast<uint32_t>(x ^ (x >> 31)) & slot_mask;
+}
+
+// Minimal perfect hash (hash and displace) from field names to positions in a field table
+struct FieldIndexView {
+    static constexpr uint16_t kEmpty = 0xFFFF;
+    static constexpr size_t kMaxFields = 0x8000;
+    static constexpr uint32_t kMaxDisplacement = 0x10000;
+
+    const uint16_t* slots = nullptr;
+    const uint32_t* displacements = nullptr;
+    uint32_t slot_mask = 0;
+    uint32_t bucket_mask = 0;
+
+    static constexpr size_t SlotCount(size_t field_count) {
+        return _CeilPow2(field_count * 2);
+    }
+
+    static constexpr size_t BucketCount(size_t field_count) {
+        return _CeilPow2((field_count + 1) / 2);
+    }
+
+    // Returns the only position name can be at, or kEmpty
+    constexpr uint16_t Lookup(std::string_view name) const {
+        const auto h = HashFieldName(name);
+        return slots[_FieldIndexSlot(h, displacements[_FieldIndexBucket(h, bucket_mask)], slot_mask)];
+    }
+};
+
+// hashes and order are scratch arrays of field_count elements.
+// Buckets are placed largest first, trying displacements until all keys of the bucket land on free slots.
+template <class Field>
+constexpr bool BuildFieldIndex(const Field* fields, size_t field_count,
+                               uint16_t* slots, uint32_t* displacements,
+                               uint64_t* hashes, uint16_t* order) {
+    if (field_count > FieldIndexView::kMaxFields)
+        return false;
+    const auto slot_count = FieldIndexView::SlotCount(field_count);
+    const auto bucket_count = FieldIndexView::BucketCount(field_count);
+    const auto slot_mask = static_cast<uint32_t>(slot_count - 1);
+    const auto bucket_mask = static_cast<uint32_t>(bucket_count - 1);
+
+    for (size_t i = 0; i < slot_count; ++i)
+        slots[i] = FieldIndexView::kEmpty;
+    for (size_t i = 0; i < bucket_count; ++i)
+        displacements[i] = 0;
+    for (size_t i = 0; i < field_count; ++i) {
+        hashes[i] = HashFieldName(fields[i].name);
+        ++displacements[_FieldIndexBucket(hashes[i], bucket_mask)];
+    }
+
+    auto before = [&](uint16_t a, uint16_t b) {
+        const auto ba = _FieldIndexBucket(hashes[a], bucket_mask);
+        const auto bb = _FieldIndexBucket(hashes[b], bucket_mask);
+        return displacements[ba] != displacements[bb] ? displacements[ba] > displacements[bb] : ba < bb;
+    };
+    for (size_t i = 0; i < field_count; ++i) {
+        size_t j = i;
+        for (; j > 0 && before(static_cast<uint16_t>(i), order[j - 1]); --j)
+            order[j] = order[j - 1];
+        order[j] = static_cast<uint16_t>(i);
+    }
+    for (size_t i = 0; i < bucket_count; ++i)
+        displacements[i] = 0;
+
+    for (size_t first = 0; first < field_count;) {
+        const auto bucket = _FieldIndexBucket(hashes[order[first]], bucket_mask);
+        size_t last = first + 1;
+        while (last < field_count && _FieldIndexBucket(hashes[order[last]], bucket_mask) == bucket)
+            ++last;
+
+        bool placed = false;
+        for (uint32_t displacement = 0; displacement < FieldIndexView::kMaxDisplacement && !placed; ++displacement) {
+            placed = true;
+            for (size_t i = first; i < last && placed; ++i) {
+                const auto slot = _FieldIndexSlot(hashes[order[i]], displacement, slot_mask);
+                placed = slots[slot] == FieldIndexView::kEmpty;
+                for (size_t j = first; j < i && placed; ++j)
+                    placed = _FieldIndexSlot(hashes[order[j]], displacement, slot_mask) != slot;
+            }
+            if (placed) {
+                displacements[bucket] = displacement;
+                for (size_t i = first; i < last; ++i)
+                    slots[_FieldIndexSlot(hashes[order[i]], displacement, slot_mask)] = order[i];
+            }
+        }
+        if (!placed)
+            return false;
+        first = last;
+    }
+    return true;
+}
+
+// Index of a field table built at compile time
+template <size_t N>
+class FieldIndex {
+public:
+    static constexpr size_t kSlotCount = FieldIndexView::SlotCount(N);
+    static constexpr size_t kBucketCount = FieldIndexView::BucketCount(N);
+
+    template <class Field>
+    constexpr explicit FieldIndex(const std::array<Field, N>& fields) {
+        std::array<uint64_t, N + 1> hashes{};
+        std::array<uint16_t, N + 1> order{};
+        valid = BuildFieldIndex(fields.data(), N, slots.data(), displacements.data(), hashes.data(), order.data());
+    }
+
+    constexpr bool IsValid() const {
+        return valid;
+    }
+
+    constexpr FieldIndexView GetView() const {
+        return FieldIndexView{slots.data(), displacements.data(),
+                              static_cast<uint32_t>(kSlotCount - 1), static_cast<uint32_t>(kBucketCount - 1)};
+    }
+
+private:
+    std::array<uint16_t, kSlotCount> slots{};
+    std::array<uint32_t, kBucketCount> displacements{};
+    bool valid = false;
+};
+
+// Read-only view over a contiguous array of fields sorted by name,
+// bound to the object whose start the field offsets are relative to
+template <class Field>
+class BasicFieldTable {
+public:
+    using PropertyTypePointer = decltype(Field::property);
+
+    constexpr BasicFieldTable() = default;
+
+    constexpr BasicFieldTable(const Field* first, const Field* last, FieldIndexView index = {}, const void* object = nullptr,
+                              PropertyTypePointer type = nullptr)
+        : first_(first), last_(last), index_(index), object_(object), type_(type) {
+    }
+
+    template <size_t N>
+    constexpr BasicFieldTable(const std::array<Field, N>& fields, FieldIndexView index = {}, const void* object = nullptr,
+                              PropertyTypePointer type = nullptr)
+        : first_(fields.data()), last_(fields.data() + N), index_(index), object_(object), type_(type) {
+    }
+
+    const void* GetObject() const {
+        return object_;
+    }
+
+    // Type the fields are declared in, which is the dynamic type of the object
+    // unless a subclass declares no fields
+    PropertyTypePointer GetType() const {
+        return type_;
+    }
+
+    void* GetAddress(const Field& field) const {
+        const auto object = const_cast<void*>(object_);
+        return field.offset != kNoFieldOffset ? static_cast<char*>(object) + field.offset : field.access(object);
+    }
+
+    constexpr const Field* begin() const {
+        return first_;
+    }
+
+    constexpr const Field* end() const {
+        return last_;
+    }
+
+    constexpr size_t size() const {
+        return static_cast<size_t>(last_ - first_);
+    }
+
+    // Returns nullptr if there is no field with that name
+    const Field* Find(std::string_view name) const {
+        if (index_.slots != nullptr) {
+            const auto i = index_.Lookup(name);
+            return i != FieldIndexView::kEmpty && first_[i].name == name ? first_ + i : nullptr;
+        }
+        auto itr = std::lower_bound(first_, last_, name, [](const Field& field, std::string_view key) {
+            return field.name < key;
+        });
+        return itr != last_ && itr->name == name ? itr : nullptr;
+    }
+
+private:
+    const Field* first_ = nullptr;
+    const Field* last_ = nullptr;
+    FieldIndexView index_;
+    const void* object_ = nullptr;
+    PropertyTypePointer type_ = nullptr;
+};
+
 template <class I>
 class IReflectionBase {
 public:
-    struct FieldInfo {
-        void* address;
+    struct Field {
+        std::string_view name;
+        // kNoFieldOffset if the field is reached through access
+        size_t offset;
+        void* (*access)(void* object);
         const IType<I>* type;
         const UserdataBase* userdata;
+        const IPropertyType<I>* property;
     };
 
-    using GetFieldFunc = FieldInfo (*)(I*);
-    using FieldTable = std::map<std::string, GetFieldFunc>;
+    using FieldTable = BasicFieldTable<Field>;
 
     // Arg is used to avoid signature collision when a class implements multiple interfaces
-    virtual const FieldTable& GetFieldTable(I* = nullptr) const = 0;
+    virtual FieldTable GetFieldTable(I* = nullptr) const = 0;
 
     virtual ~IReflectionBase(){};
 };
 
-template <class I, class T>
-const auto& GetFieldTable(const T& object, I* = nullptr) {
-    return object.GetFieldTable(static_cast<I*>(nullptr));
-}
-
 template <class I, class T, class Enable = void>
 class Type;
 
@@ -137,23 +382,377 @@ public:
 
     struct Userdata : UserdataBase {};
 
-    static const IType<I>* GetIType() {
-        static const Type<I, T> instance;
+    static constexpr const IType<I>* GetIType() {
         return &instance;
     }
 
+    // Calls through GetType().Type<I, T>::Func() are not virtual and can be inlined
+    static constexpr const Type<I, T>& GetType() {
+        return instance;
+    }
+
 protected:
-    TypeBase(){};
+    constexpr TypeBase(){};
+
+private:
+    static const Type<I, T> instance;
 };
 
-template <class T>
-struct SubclassInfo {
-    static constexpr bool has = false;
+template <class I, class T>
+const Type<I, T> TypeBase<I, T>::instance{};
+
+struct FieldDeclarationEnd {};
+
+// Userdata is set up once, when the declaration is evaluated at compile time
+template <class I, class T>
+struct FieldDeclaration {
+    using ValueType = T;
+
+    std::string_view name;
+    size_t offset;
+    void* (*access)(void* object);
+    typename Type<I, T>::Userdata userdata;
+
+    constexpr typename IReflectionBase<I>::Field GetField() const {
+        return {name, offset, access, Type<I, T>::GetIType(), &userdata, PropertyType<I, T>::GetIPropertyType()};
+    }
+
+    // Address of the field in object, a pointer to the declaring class
+    void* GetAddress(void* object) const {
+        return offset != kNoFieldOffset ? static_cast<char*>(object) + offset : access(object);
+    }
 };
 
+template <class I, class T, class Init>
+constexpr FieldDeclaration<I, T> MakeFieldDeclaration(std::string_view name, size_t offset, void* (*access)(void*), Init init) {
+    FieldDeclaration<I, T> declaration{name, offset, access, {}};
+    init(declaration.userdata);
+    return declaration;
+}
+
+template <class Tuple, size_t... Is>
+constexpr std::array<std::string_view, sizeof...(Is)> _GetFieldNames(const Tuple& declarations, std::index_sequence<Is...>) {
+    return {std::get<Is>(declarations).name...};
+}
+
+// Names of a declaration tuple ending with FieldDeclarationEnd
+template <class... Declarations>
+constexpr auto GetFieldNames(const std::tuple<Declarations...>& declarations) {
+    return _GetFieldNames(declarations, std::make_index_sequence<sizeof...(Declarations) - 1>());
+}
+
+template <size_t N>
+constexpr bool _IsFirstFieldName(const std::array<std::string_view, N>& names, size_t i) {
+    for (size_t j = 0; j < i; ++j)
+        if (names[j] == names[i])
+            return false;
+    return true;
+}
+
+template <class... Declarations>
+constexpr bool HasUniqueFieldNames(const std::tuple<Declarations...>& declarations) {
+    const auto names = GetFieldNames(declarations);
+    for (size_t i = 0; i < names.size(); ++i)
+        if (!_IsFirstFieldName(names, i))
+            return false;
+    return true;
+}
+
+template <class Tuple, size_t... Is>
+constexpr auto _DropFieldDeclarationEnd(const Tuple& declarations, std::index_sequence<Is...>) {
+    return std::make_tuple(std::get<Is>(declarations)...);
+}
+
+template <class... Declarations>
+constexpr auto DropFieldDeclarationEnd(const std::tuple<Declarations...>& declarations) {
+    return _DropFieldDeclarationEnd(declarations, std::make_index_sequence<sizeof...(Declarations) - 1>());
+}
+
+template <size_t N>
+constexpr size_t CountUniqueFieldNames(const std::array<std::string_view, N>& names) {
+    size_t count = 0;
+    for (size_t i = 0; i < N; ++i)
+        if (_IsFirstFieldName(names, i))
+            ++count;
+    return count;
+}
+
+// Positions of the names in name order. Of equal names only the first is kept:
+// fields of derived classes are declared first and hide those of base classes.
+template <size_t M, size_t N>
+constexpr std::array<size_t, M> SortFieldNames(const std::array<std::string_view, N>& names) {
+    std::array<size_t, M> order{};
+    size_t count = 0;
+    for (size_t i = 0; i < N; ++i) {
+        if (!_IsFirstFieldName(names, i))
+            continue;
+        size_t j = count++;
+        for (; j > 0 && names[i] < names[order[j - 1]]; --j)
+            order[j] = order[j - 1];
+        order[j] = i;
+    }
+    return order;
+}
+
 template <class I, class T>
 struct IsReflectableStruct {
     static constexpr bool value = false;
 };
 
+template <class I, class Class>
+constexpr auto GetFieldDeclarations() {
+    if constexpr (IsReflectableStruct<I, Class>::value)
+        return IsReflectableStruct<I, Class>::template GetFieldDeclarations<Class>(static_cast<I*>(nullptr));
+    else
+        return Class::template GetFieldDeclarations<Class>(static_cast<I*>(nullptr));
+}
+
+template <class I, class T, class = void>
+struct HasFieldDeclarations : std::bool_constant<IsReflectableStruct<I, T>::value> {};
+
+template <class I, class T>
+struct HasFieldDeclarations<I, T, std::void_t<decltype(T::template GetFieldDeclarations<T>(static_cast<I*>(nullptr)))>>
+    : std::true_type {};
+
+// Declarations of Class flattened with those of its base classes, evaluated at compile time
+template <class I, class Class>
+struct FieldDeclarationsOf {
+    static constexpr auto declarations = GetFieldDeclarations<I, Class>();
+    static constexpr auto names = GetFieldNames(declarations);
+    // Positions in declarations of the fields, in name order
+    static constexpr auto order = SortFieldNames<CountUniqueFieldNames(names)>(names);
+};
+
+template <class I, class Declarations, size_t... Is>
+constexpr auto _MakeFieldTable(std::index_sequence<Is...>) {
+    return std::array<typename IReflectionBase<I>::Field, sizeof...(Is)>{
+        std::get<Declarations::order[Is]>(Declarations::declarations).GetField()...};
+}
+
+// Field table of Class. Built at compile time, so the first use from several threads
+// needs no synchronization.
+template <class I, class Class>
+struct FieldTableOf {
+    using Declarations = FieldDeclarationsOf<I, Class>;
+    static constexpr auto fields = _MakeFieldTable<I, Declarations>(std::make_index_sequence<Declarations::order.size()>());
+    static constexpr FieldIndex<fields.size()> index{fields};
+    static_assert(index.IsValid(), "Failed to build field index");
+};
+
+// Instantiated after the class definition, when the declarations can be evaluated
+template <class I, class Class>
+typename IReflectionBase<I>::FieldTable GetFlattenedFieldTable(const Class* object) {
+    using Table = FieldTableOf<I, Class>;
+    return typename IReflectionBase<I>::FieldTable(Table::fields, Table::index.GetView(), object,
+                                                   PropertyType<I, Class>::GetIPropertyType());
+}
+
+template <class I, class T>
+auto GetFieldTable(const T& object, I* = nullptr) {
+    if constexpr (IsReflectableStruct<I, T>::value)
+        return GetFlattenedFieldTable<I>(&object);
+    else
+        return object.GetFieldTable(static_cast<I*>(nullptr));
+}
+
+template <size_t Position, class Declarations, class T, class F>
+void _VisitField(T& object, F& f) {
+    const auto& declaration = std::get<Position>(Declarations::declarations);
+    using ValueType = typename std::decay_t<decltype(declaration)>::ValueType;
+    using Member = std::conditional_t<std::is_const_v<T>, const ValueType, ValueType>;
+    f(declaration.name, *static_cast<Member*>(declaration.GetAddress(const_cast<std::remove_const_t<T>*>(&object))));
+}
+
+template <class Declarations, class T, class F, size_t... Is>
+void _ForEachField(T& object, F& f, std::index_sequence<Is...>) {
+    (_VisitField<Declarations::order[Is], Declarations>(object, f), ...);
+}
+
+// Calls f(name, member) for the fields of T, those of base classes included, in name order.
+// Members are passed as typed references, so calls can be inlined. Only fields known to
+// the static type T are visited.
+template <class I, class T, class F>
+void for_each_field(T& object, F&& f) {
+    using Declarations = FieldDeclarationsOf<I, std::remove_const_t<T>>;
+    _ForEachField<Declarations>(object, f, std::make_index_sequence<Declarations::order.size()>());
+}
+
+// True if the dynamic type of object is T, so that for_each_field visits all of its fields
+template <class T>
+bool IsExactType(const T& object) {
+    if constexpr (!std::is_polymorphic_v<T> || std::is_final_v<T>)
+        return true;
+    else
+        return typeid(object) == typeid(T);
+}
+
+// Creates T in memory from resource, or with new if resource is nullptr
+template <class T>
+T* CreateObject(std::pmr::memory_resource* resource) {
+    if (resource == nullptr)
+        return new T();
+    void* memory = resource->allocate(sizeof(T), alignof(T));
+    try {
+        return new (memory) T();
+    } catch (...) {
+        resource->deallocate(memory, sizeof(T), alignof(T));
+        throw;
+    }
+}
+
+// unique_ptr deleter for objects created by CreateObject. Objects of a monotonic or pool
+// resource are kept together and freed with it. Default constructed, it deletes with delete.
+class ResourceDeleter {
+public:
+    constexpr ResourceDeleter() = default;
+
+    constexpr ResourceDeleter(std::pmr::memory_resource* resource, size_t size, size_t alignment)
+        : resource(resource), size(size), alignment(alignment) {
+    }
+
+    template <class T>
+    void operator()(T* p) const {
+        if (resource == nullptr) {
+            delete p;
+            return;
+        }
+        void* memory = p;
+        if constexpr (std::is_polymorphic_v<T>)
+            memory = dynamic_cast<void*>(p);
+        p->~T();
+        resource->deallocate(memory, size, alignment);
+    }
+
+    std::pmr::memory_resource* GetResource() const {
+        return resource;
+    }
+
+private:
+    std::pmr::memory_resource* resource = nullptr;
+    size_t size = 0;
+    size_t alignment = 0;
+};
+
+// Objects must be created with new for deleters that cannot release resource memory
+template <class Deleter>
+std::pmr::memory_resource* ResourceForDeleter(std::pmr::memory_resource* resource) {
+    if constexpr (std::is_constructible_v<Deleter, std::pmr::memory_resource*, size_t, size_t>)
+        return resource;
+    else
+        return nullptr;
+}
+
+// Replaces the object of p, along with the deleter if it depends on where the object lives
+template <class T, class Deleter>
+void ResetUniquePtr(std::unique_ptr<T, Deleter>& p, T* object, std::pmr::memory_resource* resource, size_t size, size_t alignment) {
+    if constexpr (std::is_constructible_v<Deleter, std::pmr::memory_resource*, size_t, size_t>)
+        p = std::unique_ptr<T, Deleter>(object, Deleter(resource, size, alignment));
+    else
+        p.reset(object);
+}
+
+template <class T>
+struct SubclassInfo {
+    static constexpr bool has = false;
+};
+
+// FNV-1a, stable across compilers and runs
+constexpr uint32_t HashTypeName(std::string_view name) {
+    uint32_t h = 2166136261u;
+    for (char c : name) {
+        h ^= static_cast<unsigned char>(c);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+template <class Entry, size_t N>
+constexpr bool HasUniqueTypeIds(const Entry (&entries)[N]) {
+    for (size_t i = 0; i + 1 < N; ++i)
+        for (size_t j = 0; j < i; ++j)
+            if (entries[i].id == entries[j].id)
+                return false;
+    return true;
+}
+
+// Registered subclasses of Base, looked up by type id, name or dynamic type
+// through open addressing tables built once
+template <class Base>
+class SubclassTable {
+public:
+    using FactoryFunc = Base* (*)(std::pmr::memory_resource*);
+
+    struct Entry {
+        std::string_view name;
+        uint32_t id;
+        size_t size;
+        size_t alignment;
+        const std::type_info& (*type)();
+        FactoryFunc factory;
+    };
+
+    // The last entry is a terminator
+    template <size_t N>
+    explicit SubclassTable(const Entry (&entries)[N])
+        : first_(entries), last_(entries + N - 1), by_id(_CeilPow2((N - 1) * 2)), by_type(by_id.size()) {
+        const auto mask = by_id.size() - 1;
+        for (auto entry = first_; entry != last_; ++entry) {
+            auto i = entry->id & mask;
+            while (by_id[i] != nullptr)
+                i = (i + 1) & mask;
+            by_id[i] = entry;
+            i = entry->type().hash_code() & mask;
+            while (by_type[i] != nullptr)
+                i = (i + 1) & mask;
+            by_type[i] = entry;
+        }
+    }
+
+    const Entry* begin() const {
+        return first_;
+    }
+
+    const Entry* end() const {
+        return last_;
+    }
+
+    const Entry* FindById(uint32_t id) const {
+        const auto mask = by_id.size() - 1;
+        for (auto i = id & mask; by_id[i] != nullptr; i = (i + 1) & mask)
+            if (by_id[i]->id == id)
+                return by_id[i];
+        return nullptr;
+    }
+
+    // Also accepts typeid names, which documents carried before type ids
+    const Entry* FindByName(std::string_view name) const {
+        auto entry = FindById(HashTypeName(name));
+        if (entry != nullptr && entry->name == name)
+            return entry;
+        for (entry = first_; entry != last_; ++entry)
+            if (name == entry->type().name())
+                return entry;
+        return nullptr;
+    }
+
+    const Entry* FindByType(const std::type_info& type) const {
+        const auto mask = by_type.size() - 1;
+        for (auto i = type.hash_code() & mask; by_type[i] != nullptr; i = (i + 1) & mask)
+            if (by_type[i]->type() == type)
+                return by_type[i];
+        return nullptr;
+    }
+
+private:
+    const Entry* first_;
+    const Entry* last_;
+    std::vector<const Entry*> by_id;
+    std::vector<const Entry*> by_type;
+};
+
 }  // namespace reflection
+
+// Property types must be complete where field tables are built
+#include "property.h"
+#include "compare.h"
+#include "clone.h"
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <magic_enum.hpp>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "binary.h"
+#include "compare.h"
+#include "reflection.h"
+
+// Compile-time schema fingerprints, and the memory layouts of trivially copyable
+// reflected structs that BinaryWriter writes as raw images.
+// A fingerprint covers the size of a type and, recursively, the names, offsets and types
+// of its fields declared for an interface. Values behind pointers and in containers
+// contribute their size only, so that recursive types have one too.
+
+namespace reflection {
+
+constexpr uint64_t _SchemaMix(uint64_t h, uint64_t v) {
+    return (h ^ v) * 0x100000001B3ull;
+}
+
+constexpr uint64_t _SchemaMixString(uint64_t h, std::string_view s) {
+    h = _SchemaMix(h, s.size());
+    for (const char c : s)
+        h = _SchemaMix(h, static_cast<unsigned char>(c));
+    return h;
+}
+
+// Scalars of arrays, or T itself
+template <class T>
+struct _SchemaScalar {
+    using type = T;
+};
+
+template <class T, size_t N>
+struct _SchemaScalar<T[N]> : _SchemaScalar<T> {};
+
+template <class T, size_t N>
+struct _SchemaScalar<std::array<T, N>> : _SchemaScalar<T> {};
+
+template <class T>
+constexpr BinaryRawKind _SchemaKind() {
+    if constexpr (std::is_enum_v<T>) {
+        return _SchemaKind<std::underlying_type_t<T>>();
+    } else if constexpr (std::is_same_v<T, bool>) {
+        return BinaryRawKind::Bool;
+    } else if constexpr (std::is_integral_v<T>) {
+        constexpr size_t log2 = sizeof(T) == 1 ? 0 : sizeof(T) == 2 ? 1 : sizeof(T) == 4 ? 2 : 3;
+        return static_cast<BinaryRawKind>(static_cast<size_t>(BinaryRawKind::Int8) + log2 * 2 + (std::is_unsigned_v<T> ? 1 : 0));
+    } else if constexpr (std::is_same_v<T, float>) {
+        return BinaryRawKind::Float32;
+    } else if constexpr (std::is_same_v<T, double>) {
+        return BinaryRawKind::Float64;
+    } else {
+        return BinaryRawKind::Bytes;
+    }
+}
+
+template <class I, class T>
+constexpr uint64_t SchemaHash();
+
+template <class I, class T, size_t... Ks>
+constexpr uint64_t _SchemaHashFields(uint64_t h, std::index_sequence<Ks...>) {
+    using Layout = FieldLayout<I, T>;
+    ((h = _SchemaMix(_SchemaMix(_SchemaMixString(h, Layout::Declarations::names[Layout::Declarations::order[Ks]]), Layout::template kOffset<Ks>),
+                     SchemaHash<I, typename Layout::template FieldType<Ks>>())),
+     ...);
+    return h;
+}
+
+// Fingerprint of T as declared for I
+template <class I, class T>
+constexpr uint64_t SchemaHash() {
+    const uint64_t h = _SchemaMix(_SchemaMix(0xCBF29CE484222325ull, sizeof(T)), alignof(T));
+    if constexpr (std::is_array_v<T>)
+        return _SchemaMix(_SchemaMix(h, 'A'), SchemaHash<I, std::remove_extent_t<T>>());
+    else if constexpr (_IsStdArray<T>::value)
+        return _SchemaMix(_SchemaMix(h, 'A'), SchemaHash<I, typename T::value_type>());
+    else if constexpr (HasFieldDeclarations<I, T>::value)
+        return _SchemaHashFields<I, T>(_SchemaMix(h, 'F'), std::make_index_sequence<FieldLayout<I, T>::kFieldCount>());
+    else if constexpr (std::is_arithmetic_v<T> || std::is_enum_v<T>)
+        return _SchemaMix(_SchemaMix(h, 'S'), static_cast<uint64_t>(_SchemaKind<T>()) + (std::is_enum_v<T> ? 0x100 : 0));
+    else
+        return _SchemaMix(_SchemaMix(h, 'O'), std::is_trivially_copyable_v<T>);
+}
+
+template <class I, class T>
+constexpr bool IsRawSerializable();
+
+template <class I, class T, size_t... Ks>
+constexpr bool _IsRawSerializableFields(std::index_sequence<Ks...>) {
+    return (IsRawSerializable<I, typename FieldLayout<I, T>::template FieldType<Ks>>() && ...);
+}
+
+// True if T is written as its memory image in raw mode: a bitwise comparable value,
+// standard-layout reflected struct of such values or array of them. Padding and undeclared
+// members are written as zeros and not read.
+template <class I, class T>
+constexpr bool IsRawSerializable() {
+    if constexpr (std::is_array_v<T>)
+        return IsRawSerializable<I, std::remove_extent_t<T>>();
+    else if constexpr (_IsStdArray<T>::value)
+        return IsRawSerializable<I, typename T::value_type>();
+    else if constexpr (HasFieldDeclarations<I, T>::value)
+        return std::is_trivially_copyable_v<T> && std::is_standard_layout_v<T> &&
+               _IsRawSerializableFields<I, T>(std::make_index_sequence<FieldLayout<I, T>::kFieldCount>());
+    else
+        return IsBitwiseComparable<I, T>();
+}
+
+// Bools read must be 0 or 1 and enum values declared, as they are from the other encodings
+template <class T>
+bool _IsRawValue(const uint8_t* p) {
+    if constexpr (std::is_same_v<T, bool>) {
+        return *p <= 1;
+    } else {
+        std::underlying_type_t<T> v;
+        memcpy(&v, p, sizeof(v));
+        return magic_enum::enum_cast<T>(v).has_value();
+    }
+}
+
+inline void _AddRawLeaf(BinaryRawLayout& layout, const std::string& path, size_t offset, BinaryRawKind kind, size_t count, size_t stride,
+                        bool (*valid)(const uint8_t*) = nullptr) {
+    layout.paths.push_back(path);
+    layout.leaves.push_back(BinaryRawLeaf{layout.paths.back(), offset, kind, count, stride, valid});
+}
+
+template <class I, class T>
+void _AppendRawLeaves(BinaryRawLayout& layout, const std::string& path, size_t offset);
+
+template <class I, class T, size_t... Ks>
+void _AppendRawFieldLeaves(BinaryRawLayout& layout, const std::string& path, size_t offset, std::index_sequence<Ks...>) {
+    using Layout = FieldLayout<I, T>;
+    (_AppendRawLeaves<I, typename Layout::template FieldType<Ks>>(
+         layout, (path.empty() ? "" : path + ".") + std::string(Layout::Declarations::names[Layout::Declarations::order[Ks]]),
+         offset + Layout::template kOffset<Ks>),
+     ...);
+}
+
+// Arrays of scalars are one leaf, arrays of structs one path per element
+template <class I, class T>
+void _AppendRawLeaves(BinaryRawLayout& layout, const std::string& path, size_t offset) {
+    using Scalar = typename _SchemaScalar<T>::type;
+    if constexpr (std::is_same_v<Scalar, bool> || std::is_enum_v<Scalar>) {
+        _AddRawLeaf(layout, path, offset, _SchemaKind<Scalar>(), sizeof(T) / sizeof(Scalar), sizeof(Scalar), &_IsRawValue<Scalar>);
+    } else if constexpr (std::is_arithmetic_v<Scalar>) {
+        _AddRawLeaf(layout, path, offset, _SchemaKind<Scalar>(), sizeof(T) / sizeof(Scalar), sizeof(Scalar));
+    } else if constexpr (std::is_array_v<T> || _IsStdArray<T>::value) {
+        using Element = std::remove_reference_t<decltype(std::declval<T&>()[0])>;
+        for (size_t i = 0; i < sizeof(T) / sizeof(Element); ++i)
+            _AppendRawLeaves<I, Element>(layout, path + "[" + std::to_string(i) + "]", offset + i * sizeof(Element));
+    } else if constexpr (HasFieldDeclarations<I, T>::value) {
+        _AppendRawFieldLeaves<I, T>(layout, path, offset, std::make_index_sequence<FieldLayout<I, T>::kFieldCount>());
+    } else {
+        _AddRawLeaf(layout, path, offset, BinaryRawKind::Bytes, sizeof(T), 1);
+    }
+}
+
+// Layout of the raw images of T, built on first use
+template <class I, class T>
+const BinaryRawLayout& GetRawLayout() {
+    static_assert(IsRawSerializable<I, T>());
+    static const BinaryRawLayout layout = [] {
+        BinaryRawLayout layout;
+        layout.hash = SchemaHash<I, T>();
+        layout.size = sizeof(T);
+        _AppendRawLeaves<I, T>(layout, "", 0);
+        _SetBinaryRawSpans(layout);
+        return layout;
+    }();
+    return layout;
+}
+
+}  // namespace reflection
@@ -2,16 +2,36 @@
 
 #include <rapidjson/document.h>
 #include <rapidjson/prettywriter.h>
+#include <rapidjson/reader.h>
+#include <rapidjson/writer.h>
 
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <deque>
+#include <functional>
 #include <list>
 #include <magic_enum.hpp>
 #include <map>
 #include <memory>
+#include <memory_resource>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <typeinfo>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include "archive.h"
+#include "binary.h"
+#include "number.h"
+#include "parallel.h"
 #include "reflection.h"
+#include "schema.h"
+#include "soa.h"
 #include "util.h"
 
 #ifndef FIELD_NOT_FOUND_HANDLE
@@ -19,101 +39,1613 @@
 #define FIELD_NOT_FOUND_HANDLE(msg) (std::cerr << (msg) << std::endl)
 #endif
 
+// Called for json members that match no field
+#ifndef FIELD_UNKNOWN_HANDLE
+#define FIELD_UNKNOWN_HANDLE(msg) FIELD_NOT_FOUND_HANDLE(msg)
+#endif
+
 namespace reflection {
 
-class ISerialization : public IReflectionBase<ISerialization> {
+class ISerialization : public IReflectionBase<ISerialization> {
+};
+
+using DeserializeParallelOptions = ParallelOptions;
+
+enum class DeserializeError {
+    None,
+    // A value has a JSON type that its field cannot be read from
+    TypeMismatch,
+    // An array has another size than its fixed-size field
+    SizeMismatch,
+    // An enum name or a subclass type that is not declared
+    UnknownName,
+    // The "type" or "data" member of a unique_ptr to a subclass is missing
+    MissingMember,
+    // Fields missing from or unknown to an object, errors in strict mode only
+    FieldNotFound,
+    FieldUnknown,
+    // The JSON text that binary input stores for a type without a binary encoding does not parse
+    InvalidText,
+    // A scalar of a raw binary image that is not a value of its type, e.g. a bool neither 0 nor 1
+    InvalidValue,
+};
+
+// Result of TryDeserialize
+struct DeserializeStatus {
+    DeserializeError error = DeserializeError::None;
+    // JSON pointer to the value that failed, e.g. "/vec/2/data/r", empty for the root
+    std::string path;
+    // Fields missing from or unknown to objects that were not errors
+    size_t fields_not_found = 0;
+    size_t fields_unknown = 0;
+
+    explicit operator bool() const {
+        return error == DeserializeError::None;
+    }
+};
+
+// Message for FIELD_UNKNOWN_HANDLE or FIELD_NOT_FOUND_HANDLE
+struct _FieldMessage {
+    bool unknown;
+    std::string text;
+};
+
+// Order of the keys in the last object read with each field table. Keys of objects written
+// by Serialize, which have the order of the one before, are matched by comparing each with
+// the field predicted at its position only, and looked up by name otherwise. Set in
+// DeserializeContext::key_orders for documents of many objects of the same types.
+struct KeyOrderCache {
+    static constexpr uint16_t kNoField = UINT16_MAX;
+
+    // Keys matched by prediction and looked up
+    size_t hits = 0;
+    size_t misses = 0;
+
+    // Field indices by key position for the table starting at fields. Stays valid as
+    // nested objects add tables.
+    std::vector<uint16_t>& GetOrder(const void* fields) {
+        if (last < tables.size() && tables[last].fields == fields)
+            return tables[last].order;
+        for (last = 0; last < tables.size(); ++last) {
+            if (tables[last].fields == fields)
+                return tables[last].order;
+        }
+        tables.push_back({fields, {}});
+        return tables.back().order;
+    }
+
+private:
+    struct Table {
+        const void* fields;
+        std::vector<uint16_t> order;
+    };
+
+    std::deque<Table> tables;
+    size_t last = 0;
+};
+
+// State shared by the nested Deserialize calls of one deserialization
+struct DeserializeContext {
+    // Allocates objects created for unique_ptr whose deleter can release them (see ResourceDeleter).
+    // Other objects, and all objects if nullptr, are created with new.
+    std::pmr::memory_resource* resource = nullptr;
+    // Large arrays and objects of a Document are deserialized in parallel if set
+    const DeserializeParallelOptions* parallel = nullptr;
+    // Reads into the existing elements, map values and objects of unique_ptr of the same
+    // type, rather than new ones, to reuse their memory (see DeserializeInPlace)
+    bool in_place = false;
+    // On parallel threads: resource behind a lock, and the field messages, which are
+    // reported in order once all threads are done
+    std::pmr::memory_resource* locked_resource = nullptr;
+    std::vector<_FieldMessage>* messages = nullptr;
+    // Keys read by the maps being read in place, a stack of sets shared by nested maps,
+    // and the key looked up, kept so that their memory is reused
+    std::vector<const void*> keys{};
+    std::string key{};
+    // If set, deserialization stops at the first value in error and records it here rather
+    // than throwing, and counts fields missing or unknown rather than reporting them.
+    // In strict mode those fields are errors too. Parallel options are ignored then.
+    // Readers still throw on text or bytes they cannot parse.
+    DeserializeStatus* status = nullptr;
+    bool strict = false;
+    // Predicts the keys of objects if set. Parallel threads each use a cache of their own,
+    // whose hits and misses are added to it.
+    KeyOrderCache* key_orders = nullptr;
+};
+
+// Order of the keys of objects with the fields of table, nullptr without a cache
+template <class FieldTable>
+std::vector<uint16_t>* _GetKeyOrder(const FieldTable& table, DeserializeContext& context) {
+    return context.key_orders != nullptr ? &context.key_orders->GetOrder(table.begin()) : nullptr;
+}
+
+// Field of the key at position of an object, predicted from order and recorded there if
+// there is one, looked up otherwise. Positions past the fields of the table are not predicted.
+template <class FieldTable>
+auto _FindField(const FieldTable& table, std::vector<uint16_t>* order, size_t position, std::string_view key, DeserializeContext& context) {
+    if (order == nullptr)
+        return table.Find(key);
+    auto& cache = *context.key_orders;
+    if (position < order->size() && (*order)[position] < table.size()) {
+        const auto predicted = table.begin() + (*order)[position];
+        if (predicted->name == key) {
+            ++cache.hits;
+            return predicted;
+        }
+    }
+    ++cache.misses;
+    const auto field = table.Find(key);
+    if (position < table.size()) {
+        if (position >= order->size())
+            order->resize(position + 1, KeyOrderCache::kNoField);
+        (*order)[position] = field != nullptr ? static_cast<uint16_t>(field - table.begin()) : KeyOrderCache::kNoField;
+    }
+    return field;
+}
+
+// R_ASSERT for the input of Deserialize, Read and ReadBinary, which with a status records
+// code and returns instead
+#define R_DESERIALIZE_EXPECT(context, exp, code) \
+    do {                                         \
+        if (!(exp)) {                            \
+            if ((context).status == nullptr)     \
+                R_FAIL(#exp);                    \
+            (context).status->error = (code);    \
+            return;                              \
+        }                                        \
+    } while (0)
+
+// After a nested Deserialize: true if it failed, with the segment of its value added to the
+// front of the path
+inline bool _DeserializeFailed(DeserializeContext& context, std::string_view segment) {
+    if (context.status == nullptr || context.status->error == DeserializeError::None)
+        return false;
+    std::string escaped = "/";
+    for (const char c : segment) {
+        if (c == '~')
+            escaped += "~0";
+        else if (c == '/')
+            escaped += "~1";
+        else
+            escaped += c;
+    }
+    context.status->path.insert(0, escaped);
+    return true;
+}
+
+inline bool _DeserializeFailed(DeserializeContext& context, size_t index) {
+    if (context.status == nullptr || context.status->error == DeserializeError::None)
+        return false;
+    context.status->path.insert(0, "/" + std::to_string(index));
+    return true;
+}
+
+// The handlers may be statements, e.g. throw
+inline void _ReportField(DeserializeContext& context, _FieldMessage message) {
+    if (context.messages != nullptr) {
+        context.messages->push_back(std::move(message));
+    } else if (message.unknown) {
+        FIELD_UNKNOWN_HANDLE(message.text);
+    } else {
+        FIELD_NOT_FOUND_HANDLE(message.text);
+    }
+}
+
+// With a status, fields are counted or are errors, without messages
+inline bool _CountField(DeserializeContext& context, bool unknown) {
+    if (context.status == nullptr)
+        return false;
+    ++(unknown ? context.status->fields_unknown : context.status->fields_not_found);
+    if (context.strict)
+        context.status->error = unknown ? DeserializeError::FieldUnknown : DeserializeError::FieldNotFound;
+    return true;
+}
+
+inline void _FieldUnknown(DeserializeContext& context, std::string_view name) {
+    if (!_CountField(context, true))
+        _ReportField(context, {true, "Field \"" + std::string(name) + "\" unknown"});
+}
+
+inline void _FieldNotFound(DeserializeContext& context, std::string_view name) {
+    if (!_CountField(context, false))
+        _ReportField(context, {false, "Field \"" + std::string(name) + "\" not found"});
+}
+
+// Memory to create objects in for a deleter that releases them to resource
+inline std::pmr::memory_resource* _AllocatorFor(const DeserializeContext& context, std::pmr::memory_resource* resource) {
+    return resource != nullptr && context.locked_resource != nullptr ? context.locked_resource : resource;
+}
+
+inline bool _IsParallel(const DeserializeContext& context, size_t count) {
+    return context.parallel != nullptr && context.status == nullptr && count >= std::max<size_t>(context.parallel->min_elements, 2) &&
+           GetThreadCount(context.parallel->threads) > 1;
+}
+
+// Runs deserialize(i, context) for count elements on the threads of context.parallel, in chunks
+// of elements with contexts of their own that do not go parallel again. The field messages are
+// reported, and the first exception rethrown, in the order of the elements.
+inline void _DeserializeInParallel(size_t count, DeserializeContext& context, const std::function<void(size_t, DeserializeContext&)>& deserialize) {
+    struct Chunk {
+        std::vector<_FieldMessage> messages;
+        std::exception_ptr error;
+        size_t key_hits = 0;
+        size_t key_misses = 0;
+    };
+    const auto threads = GetThreadCount(context.parallel->threads);
+    const auto chunk_count = std::min(count, threads * std::max<size_t>(context.parallel->chunks_per_thread, 1));
+    std::vector<Chunk> chunks(chunk_count);
+    LockedResource locked(context.resource);
+    // Chunks after a failed one stop, those before it go on for their messages
+    std::atomic<size_t> failed{chunk_count};
+    ParallelFor(chunk_count, threads, [&](size_t c) {
+        auto chunk_context = context;
+        chunk_context.parallel = nullptr;
+        chunk_context.locked_resource = context.resource != nullptr ? &locked : nullptr;
+        chunk_context.messages = &chunks[c].messages;
+        KeyOrderCache key_orders;
+        chunk_context.key_orders = context.key_orders != nullptr ? &key_orders : nullptr;
+        const auto last = count * (c + 1) / chunk_count;
+        try {
+            for (auto i = count * c / chunk_count; i < last && c < failed.load(); ++i)
+                deserialize(i, chunk_context);
+        } catch (...) {
+            chunks[c].error = std::current_exception();
+            for (auto f = failed.load(); c < f && !failed.compare_exchange_weak(f, c);) {
+            }
+        }
+        chunks[c].key_hits = key_orders.hits;
+        chunks[c].key_misses = key_orders.misses;
+    });
+    if (context.key_orders != nullptr) {
+        for (auto& chunk : chunks) {
+            context.key_orders->hits += chunk.key_hits;
+            context.key_orders->misses += chunk.key_misses;
+        }
+    }
+    for (auto& chunk : chunks) {
+        for (auto& message : chunk.messages)
+            _ReportField(context, std::move(message));
+        if (chunk.error)
+            std::rethrow_exception(chunk.error);
+    }
+}
+
+// Output of Serialize, one call per JSON token. SerializationWriter adapts writers
+// with the interface of rapidjson::Writer to it.
+class ISerializationWriter {
+public:
+    virtual ~ISerializationWriter() = default;
+
+    virtual void Null() = 0;
+
+    virtual void Bool(bool b) = 0;
+
+    virtual void Int(int i) = 0;
+
+    virtual void Uint(unsigned u) = 0;
+
+    virtual void Int64(int64_t i) = 0;
+
+    virtual void Uint64(uint64_t u) = 0;
+
+    virtual void Double(double d) = 0;
+
+    // By default written as a double
+    virtual void Float(float f) {
+        Double(f);
+    }
+
+    // Strings and object keys
+    virtual void String(const char* str, rapidjson::SizeType length) = 0;
+
+    virtual void StartObject() = 0;
+
+    virtual void EndObject() = 0;
+
+    virtual void StartArray() = 0;
+
+    virtual void EndArray() = 0;
+
+    // Writes json, the text of one value in the format of this writer and at its depth,
+    // as the next value, e.g. a value written on another thread
+    virtual void RawValue(const char* json, size_t length, rapidjson::Type type) = 0;
+
+    // True if WriteElements writes count elements in parallel, so that containers
+    // call it rather than writing their elements themselves
+    virtual bool IsParallel(size_t) const {
+        return false;
+    }
+
+    // Writes count elements of the array or object just started, element i by write(i, writer)
+    // after the key key(i) in objects. key is empty for arrays.
+    virtual void WriteElements(size_t count, const std::function<std::string_view(size_t)>& key,
+                               const std::function<void(size_t, ISerializationWriter&)>& write) {
+        for (size_t i = 0; i < count; ++i) {
+            if (key) {
+                const auto name = key(i);
+                String(name.data(), static_cast<rapidjson::SizeType>(name.size()));
+            }
+            write(i, *this);
+        }
+    }
+
+    void String(const char* str) {
+        String(str, static_cast<rapidjson::SizeType>(std::char_traits<char>::length(str)));
+    }
+};
+
+using SerializeParallelOptions = ParallelOptions;
+
+// Writer of the format of Writer into a StringBuffer, void for writers that have none. Only
+// rapidjson's writers have one, since CopySettings has to know every setting of the writer.
+template <class Writer>
+struct _ChunkWriterOf {
+    using type = void;
+};
+
+template <class SE, class TE>
+constexpr bool _IsUtf8Writer() {
+    return std::is_same_v<SE, rapidjson::UTF8<>> && std::is_same_v<TE, rapidjson::UTF8<>>;
+}
+
+// The settings are protected members, read through pointers to members of the derived class
+template <class OS, class SE, class TE, class A, unsigned F>
+struct _ChunkWriterOf<rapidjson::Writer<OS, SE, TE, A, F>> : rapidjson::Writer<OS, SE, TE, A, F> {
+    using type = std::conditional_t<_IsUtf8Writer<SE, TE>(), rapidjson::Writer<rapidjson::StringBuffer, SE, TE, A, F>, void>;
+
+    template <class ChunkWriter>
+    static void CopySettings(const rapidjson::Writer<OS, SE, TE, A, F>& writer, ChunkWriter& chunk_writer) {
+        chunk_writer.SetMaxDecimalPlaces(writer.*(&_ChunkWriterOf::maxDecimalPlaces_));
+    }
+};
+
+template <class OS, class SE, class TE, class A, unsigned F>
+struct _ChunkWriterOf<rapidjson::PrettyWriter<OS, SE, TE, A, F>> : rapidjson::PrettyWriter<OS, SE, TE, A, F> {
+    using type = std::conditional_t<_IsUtf8Writer<SE, TE>(), rapidjson::PrettyWriter<rapidjson::StringBuffer, SE, TE, A, F>, void>;
+
+    template <class ChunkWriter>
+    static void CopySettings(const rapidjson::PrettyWriter<OS, SE, TE, A, F>& writer, ChunkWriter& chunk_writer) {
+        chunk_writer.SetMaxDecimalPlaces(writer.*(&_ChunkWriterOf::maxDecimalPlaces_));
+        chunk_writer.SetIndent(writer.*(&_ChunkWriterOf::indentChar_), writer.*(&_ChunkWriterOf::indentCharCount_));
+        chunk_writer.SetFormatOptions(writer.*(&_ChunkWriterOf::formatOptions_));
+    }
+};
+
+template <class Writer>
+class SerializationWriter final : public ISerializationWriter {
+public:
+    using ISerializationWriter::String;
+
+    explicit SerializationWriter(Writer& writer, const SerializeParallelOptions* parallel = nullptr) : writer(writer), parallel(parallel) {
+    }
+
+    void Null() override {
+        writer.Null();
+    }
+
+    void Bool(bool b) override {
+        writer.Bool(b);
+    }
+
+    void Int(int i) override {
+        writer.Int(i);
+    }
+
+    void Uint(unsigned u) override {
+        writer.Uint(u);
+    }
+
+    void Int64(int64_t i) override {
+        writer.Int64(i);
+    }
+
+    void Uint64(uint64_t u) override {
+        writer.Uint64(u);
+    }
+
+    void Double(double d) override {
+        writer.Double(d);
+    }
+
+    // The shortest text that reads back as f
+    void Float(float f) override {
+        char buffer[kFloatTextSize];
+        const auto length = FormatFloat(f, buffer);
+        if (length > 0)
+            writer.RawValue(buffer, length, rapidjson::kNumberType);
+        else
+            writer.Double(f);
+    }
+
+    void String(const char* str, rapidjson::SizeType length) override {
+        writer.String(str, length);
+    }
+
+    void StartObject() override {
+        writer.StartObject();
+        ++depth;
+    }
+
+    void EndObject() override {
+        writer.EndObject();
+        --depth;
+    }
+
+    void StartArray() override {
+        writer.StartArray();
+        ++depth;
+    }
+
+    void EndArray() override {
+        writer.EndArray();
+        --depth;
+    }
+
+    void RawValue(const char* json, size_t length, rapidjson::Type type) override {
+        writer.RawValue(json, length, type);
+    }
+
+    bool IsParallel(size_t count) const override {
+        return !std::is_void_v<ChunkWriter> && parallel != nullptr && count >= std::max<size_t>(parallel->min_elements, 2) &&
+               GetThreadCount(parallel->threads) > 1;
+    }
+
+    void WriteElements(size_t count, const std::function<std::string_view(size_t)>& key,
+                       const std::function<void(size_t, ISerializationWriter&)>& write) override {
+        if constexpr (!std::is_void_v<ChunkWriter>) {
+            if (IsParallel(count)) {
+                _WriteChunks(count, key, write);
+                return;
+            }
+        }
+        ISerializationWriter::WriteElements(count, key, write);
+    }
+
+private:
+    using ChunkWriter = typename _ChunkWriterOf<Writer>::type;
+
+    // Text of a chunk, and where the text of each of its values begins and ends
+    struct _Chunk {
+        rapidjson::StringBuffer buffer;
+        std::vector<std::pair<size_t, size_t>> values;
+    };
+
+    static rapidjson::Type _RawType(char c) {
+        switch (c) {
+        case '{':
+            return rapidjson::kObjectType;
+        case '[':
+            return rapidjson::kArrayType;
+        case '"':
+            return rapidjson::kStringType;
+        case 'n':
+            return rapidjson::kNullType;
+        case 't':
+            return rapidjson::kTrueType;
+        case 'f':
+            return rapidjson::kFalseType;
+        default:
+            return rapidjson::kNumberType;
+        }
+    }
+
+    // A chunk writer starts as deep as writer, so that its indentation is the same. The values
+    // are copied one by one without the separators before them, and keys are written again.
+    void _WriteChunks(size_t count, const std::function<std::string_view(size_t)>& key,
+                      const std::function<void(size_t, ISerializationWriter&)>& write) {
+        const auto threads = GetThreadCount(parallel->threads);
+        const auto chunk_count = std::min(count, threads * std::max<size_t>(parallel->chunks_per_thread, 1));
+        std::vector<_Chunk> chunks(chunk_count);
+        ParallelFor(chunk_count, threads, [&](size_t c) {
+            auto& chunk = chunks[c];
+            ChunkWriter chunk_writer(chunk.buffer);
+            _ChunkWriterOf<Writer>::CopySettings(writer, chunk_writer);
+            SerializationWriter<ChunkWriter> sink(chunk_writer);
+            for (size_t i = 1; i < depth; ++i)
+                chunk_writer.StartArray();
+            if (key)
+                chunk_writer.StartObject();
+            else
+                chunk_writer.StartArray();
+            const auto first = count * c / chunk_count;
+            const auto last = count * (c + 1) / chunk_count;
+            chunk.values.reserve(last - first);
+            for (auto i = first; i < last; ++i) {
+                if (key) {
+                    const auto name = key(i);
+                    sink.String(name.data(), static_cast<rapidjson::SizeType>(name.size()));
+                }
+                const auto begin = chunk.buffer.GetSize();
+                write(i, sink);
+                chunk.values.emplace_back(begin, chunk.buffer.GetSize());
+            }
+        });
+        size_t i = 0;
+        for (auto& chunk : chunks) {
+            const auto text = chunk.buffer.GetString();
+            for (auto [begin, end] : chunk.values) {
+                while (text[begin] == ',' || text[begin] == ':' || text[begin] == '\n' || text[begin] == '\r' || text[begin] == ' ' || text[begin] == '\t')
+                    ++begin;
+                if (key) {
+                    const auto name = key(i);
+                    String(name.data(), static_cast<rapidjson::SizeType>(name.size()));
+                }
+                RawValue(text + begin, end - begin, _RawType(text[begin]));
+                ++i;
+            }
+        }
+    }
+
+    Writer& writer;
+    const SerializeParallelOptions* parallel;
+    size_t depth = 0;
+};
+
+// Input of Deserialize without a Document, read one token at a time.
+// Types start reading a value at its first token and stop at its last.
+class ISerializationReader {
+public:
+    enum class Token {
+        // Scalar in GetValue()
+        Value,
+        // Member name in GetValue()
+        Key,
+        StartObject,
+        EndObject,
+        StartArray,
+        EndArray,
+    };
+
+    virtual ~ISerializationReader() = default;
+
+    // Throws on parse errors and past the end of the input
+    void Next() {
+        const bool parsed = _ParseNext();
+        R_ASSERT(parsed);
+    }
+
+    Token GetToken() const {
+        return token;
+    }
+
+    // Strings are valid until Next
+    const rapidjson::Value& GetValue() const {
+        return value;
+    }
+
+    std::string_view GetString() const {
+        return std::string_view(value.GetString(), value.GetStringLength());
+    }
+
+    // True if the string of the current token is in the input buffer, as with in-situ parsing,
+    // false if it is a copy valid until Next
+    bool IsInsitu() const {
+        return insitu;
+    }
+
+    // Moves to the last token of the value that starts at the current token
+    void Skip() {
+        size_t depth = 0;
+        for (;;) {
+            if (token == Token::StartObject || token == Token::StartArray)
+                ++depth;
+            else if (token == Token::EndObject || token == Token::EndArray)
+                --depth;
+            if (depth == 0)
+                return;
+            Next();
+        }
+    }
+
+    // Reads up to capacity leading numbers of the array whose StartArray is the current
+    // token directly from the input, faster than one token at a time. The tokens go on
+    // with the element after them or the EndArray. Returns the number of values read,
+    // 0 if the input cannot be read directly.
+    size_t ReadNumbers(float* values, size_t capacity) {
+        R_ASSERT(token == Token::StartArray);
+        return _ReadNumbers(values, capacity);
+    }
+
+    size_t ReadNumbers(double* values, size_t capacity) {
+        R_ASSERT(token == Token::StartArray);
+        return _ReadNumbers(values, capacity);
+    }
+
+    // Reads the value that starts at the current token into document
+    void Read(rapidjson::Document& document) {
+        auto generator = [this](auto& handler) {
+            _Copy(handler);
+            return true;
+        };
+        document.Populate(generator);
+    }
+
+protected:
+    // rapidjson reader handler that keeps the last token
+    class Handler {
+    public:
+        explicit Handler(ISerializationReader& reader) : reader(reader) {
+        }
+
+        bool Null() {
+            _Scalar().SetNull();
+            return true;
+        }
+
+        bool Bool(bool b) {
+            _Scalar().SetBool(b);
+            return true;
+        }
+
+        bool Int(int i) {
+            _Scalar().SetInt(i);
+            return true;
+        }
+
+        bool Uint(unsigned u) {
+            _Scalar().SetUint(u);
+            return true;
+        }
+
+        bool Int64(int64_t i) {
+            _Scalar().SetInt64(i);
+            return true;
+        }
+
+        bool Uint64(uint64_t u) {
+            _Scalar().SetUint64(u);
+            return true;
+        }
+
+        bool Double(double d) {
+            _Scalar().SetDouble(d);
+            return true;
+        }
+
+        bool RawNumber(const char* str, rapidjson::SizeType length, bool copy) {
+            return String(str, length, copy);
+        }
+
+        bool String(const char* str, rapidjson::SizeType length, bool copy) {
+            _Scalar();
+            _SetString(str, length, copy);
+            return true;
+        }
+
+        bool Key(const char* str, rapidjson::SizeType length, bool copy) {
+            reader.token = Token::Key;
+            _SetString(str, length, copy);
+            return true;
+        }
+
+        bool StartObject() {
+            reader.token = Token::StartObject;
+            return true;
+        }
+
+        bool EndObject(rapidjson::SizeType) {
+            reader.token = Token::EndObject;
+            return true;
+        }
+
+        bool StartArray() {
+            reader.token = Token::StartArray;
+            return true;
+        }
+
+        bool EndArray(rapidjson::SizeType) {
+            reader.token = Token::EndArray;
+            return true;
+        }
+
+    private:
+        rapidjson::Value& _Scalar() {
+            reader.token = Token::Value;
+            return reader.value;
+        }
+
+        // Strings the parser will overwrite are copied
+        void _SetString(const char* str, rapidjson::SizeType length, bool copy) {
+            reader.insitu = !copy;
+            if (copy) {
+                reader.string.assign(str, length);
+                str = reader.string.data();
+            }
+            reader.value.SetString(rapidjson::StringRef(str, length));
+        }
+
+        ISerializationReader& reader;
+    };
+
+    // Parses the next token into the handler, returns false on errors and at the end
+    virtual bool _ParseNext() = 0;
+
+    virtual size_t _ReadNumbers(float*, size_t) {
+        return 0;
+    }
+
+    virtual size_t _ReadNumbers(double*, size_t) {
+        return 0;
+    }
+
+private:
+    template <class Output>
+    void _Copy(Output& handler) {
+        // Values read of each object or array being copied
+        std::vector<rapidjson::SizeType> counts;
+        for (;; Next()) {
+            switch (token) {
+            case Token::StartObject:
+                handler.StartObject();
+                counts.push_back(0);
+                continue;
+            case Token::StartArray:
+                handler.StartArray();
+                counts.push_back(0);
+                continue;
+            case Token::Key:
+                handler.Key(value.GetString(), value.GetStringLength(), !insitu);
+                continue;
+            case Token::EndObject:
+                handler.EndObject(counts.back());
+                counts.pop_back();
+                break;
+            case Token::EndArray:
+                handler.EndArray(counts.back());
+                counts.pop_back();
+                break;
+            case Token::Value:
+                _CopyScalar(handler);
+                break;
+            }
+            if (counts.empty())
+                return;
+            ++counts.back();
+        }
+    }
+
+    template <class Output>
+    void _CopyScalar(Output& handler) {
+        if (value.IsNull())
+            handler.Null();
+        else if (value.IsBool())
+            handler.Bool(value.GetBool());
+        else if (value.IsString())
+            // Strings in the input stay there, for std::string_view fields
+            handler.String(value.GetString(), value.GetStringLength(), !insitu);
+        else if (value.IsInt())
+            handler.Int(value.GetInt());
+        else if (value.IsUint())
+            handler.Uint(value.GetUint());
+        else if (value.IsInt64())
+            handler.Int64(value.GetInt64());
+        else if (value.IsUint64())
+            handler.Uint64(value.GetUint64());
+        else
+            handler.Double(value.GetDouble());
+    }
+
+    Token token = Token::Value;
+    rapidjson::Value value;
+    std::string string;
+    bool insitu = false;
+};
+
+// Null-terminated streams that ReadNumbers reads directly
+template <class InputStream>
+struct _IsJsonStringStream : std::false_type {};
+
+template <class Encoding>
+struct _IsJsonStringStream<rapidjson::GenericStringStream<Encoding>> : std::bool_constant<sizeof(typename Encoding::Ch) == 1> {};
+
+template <class Encoding>
+struct _IsJsonStringStream<rapidjson::GenericInsituStringStream<Encoding>> : std::bool_constant<sizeof(typename Encoding::Ch) == 1> {};
+
+// Reads from a rapidjson input stream, e.g. FileReadStream or StringStream
+template <class InputStream, unsigned parseFlags = rapidjson::kParseDefaultFlags>
+class SerializationReader final : public ISerializationReader {
+public:
+    explicit SerializationReader(InputStream& is) : is(is), handler(*this) {
+        reader.IterativeParseInit();
+    }
+
+    // Starts on the next value of the stream, after the last token of one parsed with
+    // kParseStopWhenDoneFlag
+    void Restart() {
+        reader.IterativeParseInit();
+    }
+
+private:
+    bool _ParseNext() override {
+        return reader.template IterativeParseNext<parseFlags>(is, handler);
+    }
+
+    size_t _ReadNumbers(float* values, size_t capacity) override {
+        return _Parse(values, capacity);
+    }
+
+    size_t _ReadNumbers(double* values, size_t capacity) override {
+        return _Parse(values, capacity);
+    }
+
+    // Stops where the parser can go on: before the ']' or after a ','
+    template <class T>
+    size_t _Parse(T* values, size_t capacity) {
+        if constexpr (_IsJsonStringStream<InputStream>::value && !(parseFlags & rapidjson::kParseCommentsFlag)) {
+            const char* p = is.src_;
+            const auto count = ParseJsonNumbers(p, values, capacity);
+            is.src_ += p - is.src_;
+            return count;
+        } else {
+            return 0;
+        }
+    }
+
+    InputStream& is;
+    rapidjson::Reader reader;
+    Handler handler;
+};
+
+class DiffContext;
+
+template <>
+class IType<ISerialization> {
+public:
+    virtual void Serialize(const void*, ISerializationWriter&) const = 0;
+
+    virtual void Deserialize(void*, const rapidjson::Value&, DeserializeContext&) const = 0;
+
+    // Deserializes from the value that starts at the current token of reader, with the
+    // semantics of Deserialize. By default values other than scalars are read into a Document.
+    virtual void Read(void* addr, ISerializationReader& reader, DeserializeContext& context) const;
+
+    // Writes the edits that turn a into b, which must differ. By default b is set as a whole.
+    virtual void Diff(const void* a, const void* b, DiffContext& context) const;
+
+    // Binary encoding of the same values (see binary.h). By default the JSON text is written as a string.
+    virtual void WriteBinary(const void* addr, BinaryWriter& writer) const;
+
+    // Reads a value written by WriteBinary, with the semantics of Deserialize
+    virtual void ReadBinary(void* addr, BinaryReader& reader, DeserializeContext& context) const;
+
+    // Writes the value into the slot at position slot of an archive (see archive.h).
+    // By default the JSON text is written as a string.
+    virtual void WriteArchive(const void* addr, ArchiveWriter& writer, size_t slot) const;
+};
+
+// Writes the edits of a patch. An edit addresses a value by its property path and either
+// sets it to "value", resizes it to "size", erases the key "erase" from it,
+// or sets its element "key" to "value".
+class DiffContext {
+public:
+    static constexpr auto kPathKey = "path";
+    static constexpr auto kValueKey = "value";
+    static constexpr auto kSizeKey = "size";
+    static constexpr auto kEraseKey = "erase";
+    static constexpr auto kKeyKey = "key";
+
+    explicit DiffContext(ISerializationWriter& writer) : writer(writer) {
+    }
+
+    void Set(const void* value, const IType<ISerialization>* type) {
+        _StartEdit();
+        writer.String(kValueKey);
+        type->Serialize(value, writer);
+        writer.EndObject();
+    }
+
+    void Resize(size_t size) {
+        _StartEdit();
+        writer.String(kSizeKey);
+        writer.Uint64(size);
+        writer.EndObject();
+    }
+
+    void Erase(std::string_view key) {
+        _StartEdit();
+        writer.String(kEraseKey);
+        writer.String(key.data(), static_cast<rapidjson::SizeType>(key.size()));
+        writer.EndObject();
+    }
+
+    void SetElement(std::string_view key, const void* value, const IType<ISerialization>* type) {
+        _StartEdit();
+        writer.String(kKeyKey);
+        writer.String(key.data(), static_cast<rapidjson::SizeType>(key.size()));
+        writer.String(kValueKey);
+        type->Serialize(value, writer);
+        writer.EndObject();
+    }
+
+    // The Push functions extend the path to a child and return the length to Pop back to
+
+    size_t PushField(std::string_view name) {
+        const auto size = path.size();
+        if (size != 0)
+            path += '.';
+        path += name;
+        return size;
+    }
+
+    size_t PushIndex(size_t index) {
+        const auto size = path.size();
+        path += '[';
+        path += std::to_string(index);
+        path += ']';
+        return size;
+    }
+
+    // Keys containing ']' cannot be part of a path
+    size_t PushKey(std::string_view key) {
+        const auto size = path.size();
+        path += '[';
+        path += key;
+        path += ']';
+        return size;
+    }
+
+    void Pop(size_t size) {
+        path.resize(size);
+    }
+
+private:
+    void _StartEdit() {
+        writer.StartObject();
+        writer.String(kPathKey);
+        writer.String(path.data(), static_cast<rapidjson::SizeType>(path.size()));
+    }
+
+    ISerializationWriter& writer;
+    std::string path;
+};
+
+inline void IType<ISerialization>::Read(void* addr, ISerializationReader& reader, DeserializeContext& context) const {
+    if (reader.GetToken() == ISerializationReader::Token::Value) {
+        Deserialize(addr, reader.GetValue(), context);
+    } else {
+        rapidjson::Document document;
+        reader.Read(document);
+        Deserialize(addr, document, context);
+    }
+}
+
+inline void IType<ISerialization>::Diff(const void*, const void* b, DiffContext& context) const {
+    context.Set(b, this);
+}
+
+inline void IType<ISerialization>::WriteBinary(const void* addr, BinaryWriter& writer) const {
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> json_writer(buffer);
+    SerializationWriter<rapidjson::Writer<rapidjson::StringBuffer>> sink(json_writer);
+    Serialize(addr, sink);
+    writer.WriteString(std::string_view(buffer.GetString(), buffer.GetSize()));
+}
+
+inline void IType<ISerialization>::ReadBinary(void* addr, BinaryReader& reader, DeserializeContext& context) const {
+    const auto text = reader.ReadString();
+    rapidjson::Document document;
+    document.Parse(text.data(), text.size());
+    R_DESERIALIZE_EXPECT(context, !document.HasParseError(), DeserializeError::InvalidText);
+    Deserialize(addr, document, context);
+}
+
+inline void IType<ISerialization>::WriteArchive(const void* addr, ArchiveWriter& writer, size_t slot) const {
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> json_writer(buffer);
+    SerializationWriter<rapidjson::Writer<rapidjson::StringBuffer>> sink(json_writer);
+    Serialize(addr, sink);
+    writer.Link(slot, writer.WriteString(std::string_view(buffer.GetString(), buffer.GetSize())));
+}
+
+// Bit set of fields already deserialized, on the stack unless the table is large
+class _SerializationFieldSet {
+public:
+    explicit _SerializationFieldSet(size_t size) {
+        if (size > kLocalBits) {
+            heap = std::make_unique<uint64_t[]>((size + 63) / 64);
+            bits = heap.get();
+        }
+    }
+
+    // Returns false if already set
+    bool Insert(size_t i) {
+        const auto mask = uint64_t(1) << (i % 64);
+        if (bits[i / 64] & mask)
+            return false;
+        bits[i / 64] |= mask;
+        return true;
+    }
+
+    bool Contains(size_t i) const {
+        return (bits[i / 64] >> (i % 64)) & 1;
+    }
+
+private:
+    static constexpr size_t kLocalBits = 256;
+    uint64_t local[kLocalBits / 64] = {};
+    std::unique_ptr<uint64_t[]> heap;
+    uint64_t* bits = local;
+};
+
+// Set of the addresses of the keys read from a map, an open-addressing hash table at the top
+// of stack. Nested maps put theirs above it and remove them before it is used again.
+class _SerializationKeySet {
+public:
+    explicit _SerializationKeySet(std::vector<const void*>& stack) : stack(stack), first(stack.size()) {
+        stack.resize(first + capacity);
+    }
+
+    ~_SerializationKeySet() {
+        stack.resize(first);
+    }
+
+    _SerializationKeySet(const _SerializationKeySet&) = delete;
+    _SerializationKeySet& operator=(const _SerializationKeySet&) = delete;
+
+    // Returns false if already inserted
+    bool Insert(const void* key) {
+        if ((count + 1) * 2 > capacity)
+            _Grow();
+        auto& slot = stack[_Find(first, capacity, key)];
+        if (slot != nullptr)
+            return false;
+        slot = key;
+        ++count;
+        return true;
+    }
+
+    bool Contains(const void* key) const {
+        return stack[_Find(first, capacity, key)] != nullptr;
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+private:
+    // Slot of key in the table of capacity slots at begin, or the empty slot it goes in
+    size_t _Find(size_t begin, size_t size, const void* key) const {
+        auto h = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(key)) * 0x9E3779B97F4A7C15ull;
+        for (auto i = static_cast<size_t>(h ^ (h >> 32)) & (size - 1);; i = (i + 1) & (size - 1)) {
+            if (stack[begin + i] == nullptr || stack[begin + i] == key)
+                return begin + i;
+        }
+    }
+
+    // The larger table is built above the current one and moved down
+    void _Grow() {
+        const auto larger = capacity * 2;
+        stack.resize(first + capacity + larger);
+        for (size_t i = 0; i < capacity; ++i) {
+            if (const auto key = stack[first + i])
+                stack[_Find(first + capacity, larger, key)] = key;
+        }
+        std::copy(stack.begin() + static_cast<std::ptrdiff_t>(first + capacity), stack.end(), stack.begin() + static_cast<std::ptrdiff_t>(first));
+        stack.resize(first + larger);
+        capacity = larger;
+    }
+
+    std::vector<const void*>& stack;
+    size_t first;
+    size_t capacity = 16;
+    size_t count = 0;
 };
 
-template <>
-class IType<ISerialization> {
-public:
-    virtual void Serialize(const void*, rapidjson::PrettyWriter<rapidjson::StringBuffer>&) const = 0;
+// _DeserializeFailed for the path of a raw leaf, e.g. "p[1].x", added as its segments
+inline bool _DeserializeRawFailed(DeserializeContext& context, std::string_view path) {
+    if (context.status == nullptr || context.status->error == DeserializeError::None)
+        return false;
+    // From the last segment, as each one is added to the front
+    while (!path.empty()) {
+        const auto separator = path.find_last_of(".[");
+        auto segment = separator == std::string_view::npos ? path : path.substr(separator + 1);
+        if (!segment.empty() && segment.back() == ']')
+            segment.remove_suffix(1);
+        _DeserializeFailed(context, segment);
+        path = path.substr(0, separator == std::string_view::npos ? 0 : separator);
+    }
+    return true;
+}
+
+// Reads a Raw value of objects of T into allocate(count), which returns where they go.
+// With a fixed_count other than 0, values of other counts are size mismatches.
+template <class T, class F>
+void _ReadRawBinary(BinaryReader& reader, DeserializeContext& context, size_t fixed_count, F&& allocate) {
+    reader.ExpectTag(BinaryTag::Raw);
+    const auto images = reader.ReadRaw(GetRawLayout<ISerialization, T>());
+    R_DESERIALIZE_EXPECT(context, fixed_count == 0 || images.count == fixed_count, DeserializeError::SizeMismatch);
+    if (!images.match->identical) {
+        for (const auto path : images.match->unknown) {
+            _FieldUnknown(context, path);
+            if (_DeserializeRawFailed(context, path))
+                return;
+        }
+        for (const auto path : images.match->missing) {
+            _FieldNotFound(context, path);
+            if (_DeserializeRawFailed(context, path))
+                return;
+        }
+    }
+    T* dst = allocate(images.count);
+    const bool valid = BinaryReader::CopyRaw(images, dst);
+    R_DESERIALIZE_EXPECT(context, valid, DeserializeError::InvalidValue);
+}
+
+template <class T>
+void Serialize(const T& object, ISerializationWriter& writer) {
+    using TypeT = Type<ISerialization, T>;
+    TypeT::GetType().TypeT::Serialize(&object, writer);
+}
 
-    virtual void Deserialize(void*, const rapidjson::Value&) const = 0;
+template <class T, class Writer, std::enable_if_t<!std::is_base_of_v<ISerializationWriter, Writer>, int> = 0>
+void Serialize(const T& object, Writer& writer) {
+    SerializationWriter<Writer> sink(writer);
+    Serialize(object, static_cast<ISerializationWriter&>(sink));
+}
+
+// Writes large vectors, lists and maps in parallel, with the same output as Serialize.
+// writer must be at the root.
+template <class T, class Writer, std::enable_if_t<!std::is_base_of_v<ISerializationWriter, Writer>, int> = 0>
+void Serialize(const T& object, Writer& writer, const SerializeParallelOptions& parallel) {
+    SerializationWriter<Writer> sink(writer, &parallel);
+    Serialize(object, static_cast<ISerializationWriter&>(sink));
+}
+
+enum class SerializeMode {
+    // No whitespace
+    Compact,
+    // Indented, one value per line
+    Pretty,
 };
 
 template <class T>
-void Serialize(const T& object, rapidjson::PrettyWriter<rapidjson::StringBuffer>& writer) {
-    Type<ISerialization, T>::GetIType()->Serialize(&object, writer);
+void Serialize(const T& object, rapidjson::StringBuffer& buffer, SerializeMode mode) {
+    if (mode == SerializeMode::Compact) {
+        rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+        Serialize(object, writer);
+    } else {
+        rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
+        Serialize(object, writer);
+    }
+}
+
+template <class T>
+void Serialize(const T& object, rapidjson::StringBuffer& buffer, SerializeMode mode, const SerializeParallelOptions& parallel) {
+    if (mode == SerializeMode::Compact) {
+        rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+        Serialize(object, writer, parallel);
+    } else {
+        rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
+        Serialize(object, writer, parallel);
+    }
+}
+
+template <class T>
+void Deserialize(T& object, const rapidjson::Value& value, DeserializeContext& context) {
+    using TypeT = Type<ISerialization, T>;
+    TypeT::GetType().TypeT::Deserialize(&object, value, context);
+}
+
+template <class T>
+void Deserialize(T& object, const rapidjson::Value& value, std::pmr::memory_resource* resource = nullptr) {
+    DeserializeContext context{resource};
+    Deserialize(object, value, context);
+}
+
+// Deserialize for untrusted input, without exceptions: a value with the wrong type, size or
+// name stops it, leaving object partly read, and the result has the error and the path to the
+// value. On success it allocates nothing but the memory of the values read, none for values
+// without memory of their own. Fields missing or unknown are counted, or are errors if strict,
+// rather than calling FIELD_NOT_FOUND_HANDLE and FIELD_UNKNOWN_HANDLE.
+template <class T>
+DeserializeStatus TryDeserialize(T& object, const rapidjson::Value& value, bool strict = false, std::pmr::memory_resource* resource = nullptr) {
+    DeserializeStatus status;
+    DeserializeContext context{resource};
+    context.status = &status;
+    context.strict = strict;
+    Deserialize(object, value, context);
+    return status;
+}
+
+// Deserializes into the existing elements of vectors and lists, the values of map keys and the
+// objects of unique_ptr where the input has them, so that reloading data of the same shape
+// reuses their memory and, with a context that is kept too, allocates nothing. Unlike
+// Deserialize, they keep the values of fields missing from the input.
+template <class T>
+void DeserializeInPlace(T& object, const rapidjson::Value& value, DeserializeContext& context) {
+    context.in_place = true;
+    Deserialize(object, value, context);
+}
+
+template <class T>
+void DeserializeInPlace(T& object, const rapidjson::Value& value, std::pmr::memory_resource* resource = nullptr) {
+    DeserializeContext context{resource};
+    DeserializeInPlace(object, value, context);
+}
+
+// Deserializes the elements of large vectors, lists and maps in parallel, with the same result
+// and field messages as Deserialize. resource is shared by the threads through a lock.
+template <class T>
+void Deserialize(T& object, const rapidjson::Value& value, const DeserializeParallelOptions& parallel, std::pmr::memory_resource* resource = nullptr) {
+    DeserializeContext context{resource, &parallel};
+    Deserialize(object, value, context);
+}
+
+template <class T>
+void Deserialize(T& object, ISerializationReader& reader, DeserializeContext& context) {
+    using TypeT = Type<ISerialization, T>;
+    TypeT::GetType().TypeT::Read(&object, reader, context);
+}
+
+// Deserializes the JSON text of is, a rapidjson input stream, without building a Document.
+// Reads one value and leaves the rest of is.
+template <class T, class InputStream>
+void DeserializeStream(T& object, InputStream& is, std::pmr::memory_resource* resource = nullptr) {
+    SerializationReader<InputStream, rapidjson::kParseStopWhenDoneFlag> reader(is);
+    DeserializeContext context{resource};
+    reader.Next();
+    Deserialize(object, reader, context);
+}
+
+// Like DeserializeStream, but parses buffer in place: it is modified, and std::string_view
+// and const char* fields of object point into it afterwards. buffer must be null-terminated.
+template <class T>
+void DeserializeInsitu(T& object, char* buffer, std::pmr::memory_resource* resource = nullptr) {
+    rapidjson::InsituStringStream stream(buffer);
+    SerializationReader<rapidjson::InsituStringStream, rapidjson::kParseInsituFlag | rapidjson::kParseStopWhenDoneFlag> reader(stream);
+    DeserializeContext context{resource};
+    reader.Next();
+    Deserialize(object, reader, context);
+}
+
+template <class T>
+void SerializeBinary(const T& object, BinaryWriter& writer) {
+    using TypeT = Type<ISerialization, T>;
+    TypeT::GetType().TypeT::WriteBinary(&object, writer);
+}
+
+template <class T>
+void DeserializeBinary(T& object, BinaryReader& reader, DeserializeContext& context) {
+    using TypeT = Type<ISerialization, T>;
+    TypeT::GetType().TypeT::ReadBinary(&object, reader, context);
+}
+
+// Deserializes one value written by SerializeBinary. std::string_view and const char*
+// fields of object point into data afterwards, which must outlive them.
+template <class T>
+void DeserializeBinary(T& object, const void* data, size_t size, std::pmr::memory_resource* resource = nullptr) {
+    BinaryReader reader(data, size);
+    DeserializeContext context{resource};
+    DeserializeBinary(object, reader, context);
+}
+
+template <class T>
+void SerializeArchive(const T& object, ArchiveWriter& writer, size_t slot) {
+    using TypeT = Type<ISerialization, T>;
+    TypeT::GetType().TypeT::WriteArchive(&object, writer, slot);
+}
+
+// Writes an archive with object as its root, read in place with GetArchiveRoot<T>
+template <class T>
+void SerializeArchive(const T& object, ArchiveWriter& writer) {
+    writer.Clear();
+    const auto header = writer.Allocate(kArchiveHeaderSize);
+    const auto hash = ArchiveTypeHash<ISerialization, T>();
+    writer.Store(header, kArchiveMagic, sizeof(kArchiveMagic));
+    writer.Store(header + 8, &kArchiveByteOrderMark, 4);
+    writer.Store(header + 16, &hash, 8);
+    SerializeArchive(object, writer, header + kArchiveRootSlot);
+}
+
+template <class T, size_t... Ks>
+constexpr std::array<uint64_t, sizeof...(Ks)> _ArchiveFieldHashes(std::index_sequence<Ks...>) {
+    return {ArchiveTypeHash<ISerialization, typename FieldLayout<ISerialization, T>::template FieldType<Ks>>()...};
+}
+
+// Struct record of the fields declared in T, where for_each_member calls its argument
+// with the members in name order
+template <class T, class F>
+void _WriteArchiveFields(ArchiveWriter& writer, size_t slot, F&& for_each_member) {
+    static constexpr auto hashes = _ArchiveFieldHashes<T>(std::make_index_sequence<FieldLayout<ISerialization, T>::kFieldCount>());
+    const auto& fields = FieldTableOf<ISerialization, T>::fields;
+    const auto layout = writer.WriteLayout(fields.data(), fields.size(), SchemaHash<ISerialization, T>(), hashes.data());
+    const auto record = writer.Allocate(8 + 8 * fields.size());
+    writer.Link(record, layout);
+    writer.Link(slot, record);
+    size_t position = record;
+    for_each_member([&writer, &position](const auto& member) {
+        position += 8;
+        reflection::SerializeArchive(member, writer, position);
+    });
+}
+
+// a and b must differ
+template <class T>
+void Diff(const T& a, const T& b, DiffContext& context) {
+    using TypeT = Type<ISerialization, T>;
+    TypeT::GetType().TypeT::Diff(&a, &b, context);
+}
+
+// Writes the patch that Apply uses to turn a into b, as an array of edits.
+// Unchanged values are skipped with Equal, so the patch and the cost of applying it
+// scale with the number of changes. Polymorphic a and b must have the same dynamic type.
+template <class T>
+void Diff(const T& a, const T& b, ISerializationWriter& writer) {
+    if constexpr (std::is_polymorphic_v<T>)
+        R_ASSERT(typeid(a) == typeid(b));
+    writer.StartArray();
+    if (!Equal<ISerialization>(a, b)) {
+        DiffContext context(writer);
+        Diff(a, b, context);
+    }
+    writer.EndArray();
+}
+
+template <class T, class Writer, std::enable_if_t<!std::is_base_of_v<ISerializationWriter, Writer>, int> = 0>
+void Diff(const T& a, const T& b, Writer& writer) {
+    SerializationWriter<Writer> sink(writer);
+    Diff(a, b, static_cast<ISerializationWriter&>(sink));
 }
 
+// Applies the edits of a patch written by Diff, touching only the values they address
 template <class T>
-void Deserialize(T& object, const rapidjson::Value& value) {
-    Type<ISerialization, T>::GetIType()->Deserialize(&object, value);
+void Apply(T& object, const rapidjson::Value& patch, std::pmr::memory_resource* resource = nullptr) {
+    R_ASSERT(patch.IsArray());
+    DeserializeContext context{resource};
+    for (const auto& edit : patch.GetArray()) {
+        R_ASSERT(edit.IsObject());
+        const auto path_itr = edit.FindMember(DiffContext::kPathKey);
+        R_ASSERT(path_itr != edit.MemberEnd() && path_itr->value.IsString());
+        const std::string_view path(path_itr->value.GetString(), path_itr->value.GetStringLength());
+        const auto ref = CompilePropertyPath<ISerialization, T>(path).Resolve(object);
+        R_ASSERT(ref.address != nullptr);
+
+        const auto value_itr = edit.FindMember(DiffContext::kValueKey);
+        const auto key_itr = edit.FindMember(DiffContext::kKeyKey);
+        if (key_itr != edit.MemberEnd()) {
+            R_ASSERT(key_itr->value.IsString() && value_itr != edit.MemberEnd());
+            const auto element = ref.property->Emplace(ref.address, std::string_view(key_itr->value.GetString(), key_itr->value.GetStringLength()));
+            R_ASSERT(element.address != nullptr);
+            element.type->Deserialize(element.address, value_itr->value, context);
+        } else if (value_itr != edit.MemberEnd()) {
+            ref.type->Deserialize(ref.address, value_itr->value, context);
+        } else if (const auto size_itr = edit.FindMember(DiffContext::kSizeKey); size_itr != edit.MemberEnd()) {
+            R_ASSERT(size_itr->value.IsUint64());
+            const bool resized = ref.property->Resize(ref.address, static_cast<size_t>(size_itr->value.GetUint64()));
+            R_ASSERT(resized);
+        } else {
+            const auto erase_itr = edit.FindMember(DiffContext::kEraseKey);
+            R_ASSERT(erase_itr != edit.MemberEnd() && erase_itr->value.IsString());
+            const bool erased = ref.property->Erase(ref.address, std::string_view(erase_itr->value.GetString(), erase_itr->value.GetStringLength()));
+            R_ASSERT(erased);
+        }
+    }
 }
 
 template <>
 class Type<ISerialization, int> : public TypeBase<ISerialization, int> {
 public:
-    void Serialize(const void* addr, rapidjson::PrettyWriter<rapidjson::StringBuffer>& writer) const override {
+    void Serialize(const void* addr, ISerializationWriter& writer) const override {
         const auto& v = *static_cast<const ValueType*>(addr);
         writer.Int(v);
     }
 
-    void Deserialize(void* addr, const rapidjson::Value& value) const override {
-        R_ASSERT(value.IsInt());
+    void Deserialize(void* addr, const rapidjson::Value& value, DeserializeContext& context) const override {
+        R_DESERIALIZE_EXPECT(context, value.IsInt(), DeserializeError::TypeMismatch);
         auto& v = *static_cast<ValueType*>(addr);
         v = value.GetInt();
     }
+
+    void WriteBinary(const void* addr, BinaryWriter& writer) const override {
+        writer.WriteInt(*static_cast<const ValueType*>(addr));
+    }
+
+    void ReadBinary(void* addr, BinaryReader& reader, DeserializeContext& context) const override {
+        const auto i = reader.ReadIntValue(reader.ReadTag());
+        R_DESERIALIZE_EXPECT(context, i >= INT_MIN && i <= INT_MAX, DeserializeError::TypeMismatch);
+        *static_cast<ValueType*>(addr) = static_cast<ValueType>(i);
+    }
+
+    void WriteArchive(const void* addr, ArchiveWriter& writer, size_t slot) const override {
+        writer.Store(slot, addr, sizeof(ValueType));
+    }
 };
 
 template <>
 class Type<ISerialization, bool> : public TypeBase<ISerialization, bool> {
 public:
-    void Serialize(const void* addr, rapidjson::PrettyWriter<rapidjson::StringBuffer>& writer) const override {
+    void Serialize(const void* addr, ISerializationWriter& writer) const override {
         const auto& v = *static_cast<const ValueType*>(addr);
         writer.Bool(v);
     }
 
-    void Deserialize(void* addr, const rapidjson::Value& value) const override {
-        R_ASSERT(value.IsBool());
+    void Deserialize(void* addr, const rapidjson::Value& value, DeserializeContext& context) const override {
+        R_DESERIALIZE_EXPECT(context, value.IsBool(), DeserializeError::TypeMismatch);
         auto& v = *static_cast<ValueType*>(addr);
         v = value.GetBool();
     }
+
+    void WriteBinary(const void* addr, BinaryWriter& writer) const override {
+        writer.WriteBool(*static_cast<const ValueType*>(addr));
+    }
+
+    void ReadBinary(void* addr, BinaryReader& reader, DeserializeContext& context) const override {
+        const auto tag = reader.ReadTag();
+        R_DESERIALIZE_EXPECT(context, tag == BinaryTag::True || tag == BinaryTag::False, DeserializeError::TypeMismatch);
+        *static_cast<ValueType*>(addr) = tag == BinaryTag::True;
+    }
+
+    void WriteArchive(const void* addr, ArchiveWriter& writer, size_t slot) const override {
+        writer.Store(slot, addr, sizeof(ValueType));
+    }
 };
 
 template <>
 class Type<ISerialization, float> : public TypeBase<ISerialization, float> {
 public:
-    void Serialize(const void* addr, rapidjson::PrettyWriter<rapidjson::StringBuffer>& writer) const override {
+    void Serialize(const void* addr, ISerializationWriter& writer) const override {
         const auto& v = *static_cast<const ValueType*>(addr);
-        writer.Double(static_cast<double>(v));
+        writer.Float(v);
     }
 
-    void Deserialize(void* addr, const rapidjson::Value& value) const override {
-        R_ASSERT(value.IsNumber());
+    void Deserialize(void* addr, const rapidjson::Value& value, DeserializeContext& context) const override {
+        R_DESERIALIZE_EXPECT(context, value.IsNumber(), DeserializeError::TypeMismatch);
         auto& v = *static_cast<ValueType*>(addr);
         v = value.GetFloat();
     }
+
+    void WriteBinary(const void* addr, BinaryWriter& writer) const override {
+        writer.WriteFloat(*static_cast<const ValueType*>(addr));
+    }
+
+    void ReadBinary(void* addr, BinaryReader& reader, DeserializeContext&) const override {
+        *static_cast<ValueType*>(addr) = static_cast<ValueType>(reader.ReadNumberValue(reader.ReadTag()));
+    }
+
+    void WriteArchive(const void* addr, ArchiveWriter& writer, size_t slot) const override {
+        writer.Store(slot, addr, sizeof(ValueType));
+    }
 };
 
 template <>
 class Type<ISerialization, double> : public TypeBase<ISerialization, double> {
 public:
-    void Serialize(const void* addr, rapidjson::PrettyWriter<rapidjson::StringBuffer>& writer) const override {
+    void Serialize(const void* addr, ISerializationWriter& writer) const override {
         const auto& v = *static_cast<const ValueType*>(addr);
         writer.Double(v);
     }
 
-    void Deserialize(void* addr, const rapidjson::Value& value) const override {
-        R_ASSERT(value.IsNumber());
+    void Deserialize(void* addr, const rapidjson::Value& value, DeserializeContext& context) const override {
+        R_DESERIALIZE_EXPECT(context, value.IsNumber(), DeserializeError::TypeMismatch);
         auto& v = *static_cast<ValueType*>(addr);
         v = value.GetDouble();
     }
+
+    void WriteBinary(const void* addr, BinaryWriter& writer) const override {
+        writer.WriteDouble(*static_cast<const ValueType*>(addr));
+    }
+
+    void ReadBinary(void* addr, BinaryReader& reader, DeserializeContext&) const override {
+        *static_cast<ValueType*>(addr) = reader.ReadNumberValue(reader.ReadTag());
+    }
+
+    void WriteArchive(const void* addr, ArchiveWriter& writer, size_t slot) const override {
+        writer.Store(slot, addr, sizeof(ValueType));
+    }
 };
 
 template <>
 class Type<ISerialization, std::string> : public TypeBase<ISerialization, std::string> {
 public:
-    void Serialize(const void* addr, rapidjson::PrettyWriter<rapidjson::StringBuffer>& writer) const override {
+    void Serialize(const void* addr, ISerializationWriter& writer) const override {
+        const auto& v = *static_cast<const ValueType*>(addr);
+        writer.String(v.data(), static_cast<rapidjson::SizeType>(v.size()));
+    }
+
+    void Deserialize(void* addr, const rapidjson::Value& value, DeserializeContext& context) const override {
+        R_DESERIALIZE_EXPECT(context, value.IsString(), DeserializeError::TypeMismatch);
+        auto& v = *static_cast<ValueType*>(addr);
+        v.assign(value.GetString(), value.GetStringLength());
+    }
+
+    void WriteBinary(const void* addr, BinaryWriter& writer) const override {
+        writer.WriteString(*static_cast<const ValueType*>(addr));
+    }
+
+    void ReadBinary(void* addr, BinaryReader& reader, DeserializeContext&) const override {
+        const auto s = reader.ReadString();
+        static_cast<ValueType*>(addr)->assign(s.data(), s.size());
+    }
+
+    void WriteArchive(const void* addr, ArchiveWriter& writer, size_t slot) const override {
+        writer.Link(slot, writer.WriteString(*static_cast<const ValueType*>(addr)));
+    }
+};
+
+// std::string_view and const char* fields reference the strings of the input instead of
+// copying them. Deserialized from a Value, they point into its Document, or into the
+// source buffer after ParseInsitu. Read requires in-situ parsing (see DeserializeInsitu).
+// ReadBinary points into the binary buffer.
+// The buffer or Document must outlive the object, and Clone copies the references.
+template <>
+class Type<ISerialization, std::string_view> : public TypeBase<ISerialization, std::string_view> {
+public:
+    void Serialize(const void* addr, ISerializationWriter& writer) const override {
         const auto& v = *static_cast<const ValueType*>(addr);
-        writer.String(v.c_str());
+        writer.String(v.data(), static_cast<rapidjson::SizeType>(v.size()));
+    }
+
+    void Deserialize(void* addr, const rapidjson::Value& value, DeserializeContext& context) const override {
+        R_DESERIALIZE_EXPECT(context, value.IsString(), DeserializeError::TypeMismatch);
+        auto& v = *static_cast<ValueType*>(addr);
+        v = ValueType(value.GetString(), value.GetStringLength());
+    }
+
+    void Read(void* addr, ISerializationReader& reader, DeserializeContext& context) const override {
+        R_DESERIALIZE_EXPECT(context, reader.IsInsitu(), DeserializeError::TypeMismatch);
+        Deserialize(addr, reader.GetValue(), context);
+    }
+
+    void WriteBinary(const void* addr, BinaryWriter& writer) const override {
+        writer.WriteString(*static_cast<const ValueType*>(addr));
+    }
+
+    void ReadBinary(void* addr, BinaryReader& reader, DeserializeContext&) const override {
+        *static_cast<ValueType*>(addr) = reader.ReadString();
+    }
+
+    void WriteArchive(const void* addr, ArchiveWriter& writer, size_t slot) const override {
+        writer.Link(slot, writer.WriteString(*static_cast<const ValueType*>(addr)));
+    }
+};
+
+// nullptr is serialized as null
+template <>
+class Type<ISerialization, const char*> : public TypeBase<ISerialization, const char*> {
+public:
+    void Serialize(const void* addr, ISerializationWriter& writer) const override {
+        const auto v = *static_cast<const ValueType*>(addr);
+        if (v != nullptr)
+            writer.String(v);
+        else
+            writer.Null();
+    }
+
+    void Deserialize(void* addr, const rapidjson::Value& value, DeserializeContext& context) const override {
+        R_DESERIALIZE_EXPECT(context, value.IsString() || value.IsNull(), DeserializeError::TypeMismatch);
+        auto& v = *static_cast<ValueType*>(addr);
+        v = value.IsString() ? value.GetString() : nullptr;
+    }
+
+    void Read(void* addr, ISerializationReader& reader, DeserializeContext& context) const override {
+        R_DESERIALIZE_EXPECT(context, reader.IsInsitu() || reader.GetValue().IsNull(), DeserializeError::TypeMismatch);
+        Deserialize(addr, reader.GetValue(), context);
+    }
+
+    void WriteBinary(const void* addr, BinaryWriter& writer) const override {
+        const auto v = *static_cast<const ValueType*>(addr);
+        if (v != nullptr)
+            writer.WriteString(v);
+        else
+            writer.WriteNull();
     }
 
-    void Deserialize(void* addr, const rapidjson::Value& value) const override {
-        R_ASSERT(value.IsString());
+    // Strings of the binary buffer are null-terminated
+    void ReadBinary(void* addr, BinaryReader& reader, DeserializeContext& context) const override {
         auto& v = *static_cast<ValueType*>(addr);
-        v = value.GetString();
+        const auto tag = reader.ReadTag();
+        if (tag == BinaryTag::Null) {
+            v = nullptr;
+            return;
+        }
+        R_DESERIALIZE_EXPECT(context, tag == BinaryTag::String, DeserializeError::TypeMismatch);
+        v = reader.ReadStringValue().data();
+    }
+
+    void WriteArchive(const void* addr, ArchiveWriter& writer, size_t slot) const override {
+        const auto v = *static_cast<const ValueType*>(addr);
+        if (v != nullptr)
+            writer.Link(slot, writer.WriteString(v));
     }
 };
 
@@ -122,18 +1654,33 @@ class Type<ISerialization, T, std::enable_if_t<std::is_enum_v<T>>> : public Type
 public:
     static_assert(!std::is_same_v<ISerialization, T>);
 
-    void Serialize(const void* addr, rapidjson::PrettyWriter<rapidjson::StringBuffer>& writer) const override {
+    void Serialize(const void* addr, ISerializationWriter& writer) const override {
         const auto v = *static_cast<const T*>(addr);
         writer.String(std::string(magic_enum::enum_name(v)).c_str());
     }
 
-    void Deserialize(void* addr, const rapidjson::Value& value) const override {
-        R_ASSERT(value.IsString());
+    void Deserialize(void* addr, const rapidjson::Value& value, DeserializeContext& context) const override {
+        R_DESERIALIZE_EXPECT(context, value.IsString(), DeserializeError::TypeMismatch);
         auto e = magic_enum::enum_cast<T>(value.GetString());
-        R_ASSERT(e.has_value());
+        R_DESERIALIZE_EXPECT(context, e.has_value(), DeserializeError::UnknownName);
         auto& v = *static_cast<T*>(addr);
         v = e.value();
     }
+
+    void WriteBinary(const void* addr, BinaryWriter& writer) const override {
+        writer.WriteString(magic_enum::enum_name(*static_cast<const T*>(addr)));
+    }
+
+    void ReadBinary(void* addr, BinaryReader& reader, DeserializeContext& context) const override {
+        auto e = magic_enum::enum_cast<T>(reader.ReadString());
+        R_DESERIALIZE_EXPECT(context, e.has_value(), DeserializeError::UnknownName);
+        *static_cast<T*>(addr) = e.value();
+    }
+
+    // Stored as the underlying value, unlike the other encodings
+    void WriteArchive(const void* addr, ArchiveWriter& writer, size_t slot) const override {
+        writer.Store(slot, addr, sizeof(T));
+    }
 };
 
 template <class T>
@@ -142,114 +1689,571 @@ class Type<ISerialization, T, std::enable_if_t<std::is_base_of_v<ISerialization,
 public:
     using ValueType = T;
 
-    void Serialize(const void* addr, rapidjson::PrettyWriter<rapidjson::StringBuffer>& writer) const override {
+    void Serialize(const void* addr, ISerializationWriter& writer) const override {
         const auto& v = *static_cast<const ValueType*>(addr);
         writer.StartObject();
-        for (const auto& [name, fun] : GetFieldTable(v, static_cast<ISerialization*>(nullptr))) {
-            writer.String(name.c_str());
-            auto info = fun(const_cast<ValueType*>(&v));
-            info.type->Serialize(info.address, writer);
+        if constexpr (HasFieldDeclarations<ISerialization, T>::value) {
+            if (IsExactType(v)) {
+                for_each_field<ISerialization>(v, [&writer](std::string_view name, const auto& member) {
+                    writer.String(name.data(), static_cast<rapidjson::SizeType>(name.size()));
+                    reflection::Serialize(member, writer);
+                });
+                writer.EndObject();
+                return;
+            }
+        }
+        const auto table = GetFieldTable(v, static_cast<ISerialization*>(nullptr));
+        for (const auto& field : table) {
+            writer.String(field.name.data(), static_cast<rapidjson::SizeType>(field.name.size()));
+            field.type->Serialize(table.GetAddress(field), writer);
+        }
+        writer.EndObject();
+    }
+
+    void Deserialize(void* addr, const rapidjson::Value& value, DeserializeContext& context) const override {
+        R_DESERIALIZE_EXPECT(context, value.IsObject(), DeserializeError::TypeMismatch);
+        auto& v = *static_cast<ValueType*>(addr);
+        const auto table = GetFieldTable(v, static_cast<ISerialization*>(nullptr));
+        const auto order = _GetKeyOrder(table, context);
+        _SerializationFieldSet found(table.size());
+        size_t found_count = 0;
+        size_t position = 0;
+        for (const auto& member : value.GetObject()) {
+            const std::string_view key(member.name.GetString(), member.name.GetStringLength());
+            const auto field = _FindField(table, order, position++, key, context);
+            if (field == nullptr) {
+                _FieldUnknown(context, key);
+                if (_DeserializeFailed(context, key))
+                    return;
+                continue;
+            }
+            // Like FindMember, the first of duplicated keys wins
+            if (!found.Insert(field - table.begin()))
+                continue;
+            ++found_count;
+            field->type->Deserialize(table.GetAddress(*field), member.value, context);
+            if (_DeserializeFailed(context, key))
+                return;
+        }
+        if (found_count != table.size()) {
+            for (const auto& field : table) {
+                if (found.Contains(&field - table.begin()))
+                    continue;
+                _FieldNotFound(context, field.name);
+                if (_DeserializeFailed(context, field.name))
+                    return;
+            }
+        }
+    }
+
+    void Read(void* addr, ISerializationReader& reader, DeserializeContext& context) const override {
+        R_DESERIALIZE_EXPECT(context, reader.GetToken() == ISerializationReader::Token::StartObject, DeserializeError::TypeMismatch);
+        auto& v = *static_cast<ValueType*>(addr);
+        const auto table = GetFieldTable(v, static_cast<ISerialization*>(nullptr));
+        const auto order = _GetKeyOrder(table, context);
+        _SerializationFieldSet found(table.size());
+        size_t found_count = 0;
+        size_t position = 0;
+        for (reader.Next(); reader.GetToken() != ISerializationReader::Token::EndObject; reader.Next()) {
+            const auto key = reader.GetString();
+            const auto field = _FindField(table, order, position++, key, context);
+            if (field == nullptr) {
+                _FieldUnknown(context, key);
+                if (_DeserializeFailed(context, key))
+                    return;
+                reader.Next();
+                reader.Skip();
+                continue;
+            }
+            reader.Next();
+            // The first of duplicated keys wins, as in Deserialize
+            if (!found.Insert(field - table.begin())) {
+                reader.Skip();
+                continue;
+            }
+            ++found_count;
+            field->type->Read(table.GetAddress(*field), reader, context);
+            if (_DeserializeFailed(context, field->name))
+                return;
+        }
+        if (found_count != table.size()) {
+            for (const auto& field : table) {
+                if (found.Contains(&field - table.begin()))
+                    continue;
+                _FieldNotFound(context, field.name);
+                if (_DeserializeFailed(context, field.name))
+                    return;
+            }
+        }
+    }
+
+    // Field names are written once per stream as the shape of the object.
+    // In raw mode, raw serializable objects are written as their memory image.
+    void WriteBinary(const void* addr, BinaryWriter& writer) const override {
+        const auto& v = *static_cast<const ValueType*>(addr);
+        if constexpr (IsRawSerializable<ISerialization, T>()) {
+            if (writer.IsRaw()) {
+                writer.WriteRaw(GetRawLayout<ISerialization, T>(), &v, 1);
+                return;
+            }
+        }
+        if constexpr (HasFieldDeclarations<ISerialization, T>::value) {
+            if (IsExactType(v)) {
+                const auto& fields = FieldTableOf<ISerialization, T>::fields;
+                writer.StartObject(fields.data(), fields.data() + fields.size());
+                for_each_field<ISerialization>(v, [&writer](std::string_view, const auto& member) {
+                    reflection::SerializeBinary(member, writer);
+                });
+                return;
+            }
+        }
+        const auto table = GetFieldTable(v, static_cast<ISerialization*>(nullptr));
+        writer.StartObject(table.begin(), table.end());
+        for (const auto& field : table)
+            field.type->WriteBinary(table.GetAddress(field), writer);
+    }
+
+    void ReadBinary(void* addr, BinaryReader& reader, DeserializeContext& context) const override {
+        auto& v = *static_cast<ValueType*>(addr);
+        if constexpr (IsRawSerializable<ISerialization, T>()) {
+            if (reader.PeekTag() == BinaryTag::Raw) {
+                _ReadRawBinary<T>(reader, context, 1, [&v](size_t) { return &v; });
+                return;
+            }
+        }
+        reader.ExpectTag(BinaryTag::Object);
+        const auto table = GetFieldTable(v, static_cast<ISerialization*>(nullptr));
+        auto& shape = reader.ReadShape();
+        const auto& match = reader.MatchShape(shape, table);
+        if (match.complete) {
+            for (const auto position : match.positions) {
+                const auto& field = table.begin()[position];
+                field.type->ReadBinary(table.GetAddress(field), reader, context);
+                if (_DeserializeFailed(context, field.name))
+                    return;
+            }
+            return;
+        }
+        _SerializationFieldSet found(table.size());
+        for (size_t i = 0; i < match.positions.size(); ++i) {
+            const auto position = match.positions[i];
+            if (position == BinaryReader::kNoField || position == BinaryReader::kDuplicateField) {
+                if (position == BinaryReader::kNoField) {
+                    _FieldUnknown(context, shape.names[i]);
+                    if (_DeserializeFailed(context, shape.names[i]))
+                        return;
+                }
+                reader.SkipValue(reader.ReadTag());
+                continue;
+            }
+            found.Insert(position);
+            const auto& field = table.begin()[position];
+            field.type->ReadBinary(table.GetAddress(field), reader, context);
+            if (_DeserializeFailed(context, field.name))
+                return;
+        }
+        for (const auto& field : table) {
+            if (found.Contains(&field - table.begin()))
+                continue;
+            _FieldNotFound(context, field.name);
+            if (_DeserializeFailed(context, field.name))
+                return;
+        }
+    }
+
+    // Objects are written with the layout of the class that declares their fields
+    void WriteArchive(const void* addr, ArchiveWriter& writer, size_t slot) const override {
+        const auto& v = *static_cast<const ValueType*>(addr);
+        if constexpr (HasFieldDeclarations<ISerialization, T>::value) {
+            if (IsExactType(v)) {
+                _WriteArchiveFields<T>(writer, slot, [&v](auto&& write) {
+                    for_each_field<ISerialization>(v, [&write](std::string_view, const auto& member) { write(member); });
+                });
+                return;
+            }
+        }
+        const auto table = GetFieldTable(v, static_cast<ISerialization*>(nullptr));
+        const auto type = table.GetType()->GetIType();
+        if constexpr (HasFieldDeclarations<ISerialization, T>::value) {
+            if (type == this) {
+                _WriteArchiveFields<T>(writer, slot, [&v](auto&& write) {
+                    for_each_field<ISerialization>(v, [&write](std::string_view, const auto& member) { write(member); });
+                });
+                return;
+            }
+        }
+        type->WriteArchive(table.GetObject(), writer, slot);
+    }
+
+    void Diff(const void* a, const void* b, DiffContext& context) const override {
+        const auto& va = *static_cast<const ValueType*>(a);
+        const auto& vb = *static_cast<const ValueType*>(b);
+        if constexpr (HasFieldDeclarations<ISerialization, T>::value) {
+            if (IsExactType(va)) {
+                _Diff(va, vb, context, std::make_index_sequence<FieldLayout<ISerialization, T>::kFieldCount>());
+                return;
+            }
+        }
+        const auto table_a = GetFieldTable(va, static_cast<ISerialization*>(nullptr));
+        const auto table_b = GetFieldTable(vb, static_cast<ISerialization*>(nullptr));
+        for (const auto& field : table_a) {
+            const auto field_a = table_a.GetAddress(field);
+            const auto field_b = table_b.GetAddress(field);
+            if (field.property->Equal(field_a, field_b))
+                continue;
+            const auto size = context.PushField(field.name);
+            field.type->Diff(field_a, field_b, context);
+            context.Pop(size);
+        }
+    }
+
+private:
+    template <size_t K>
+    static void _DiffField(const T& a, const T& b, DiffContext& context) {
+        using Layout = FieldLayout<ISerialization, T>;
+        using Member = typename Layout::template FieldType<K>;
+        const auto& member_a = Layout::template GetMember<K>(a);
+        const auto& member_b = Layout::template GetMember<K>(b);
+        if (Comparison<ISerialization, Member>::Equal(member_a, member_b))
+            return;
+        const auto size = context.PushField(Layout::Declarations::names[Layout::Declarations::order[K]]);
+        reflection::Diff(member_a, member_b, context);
+        context.Pop(size);
+    }
+
+    template <size_t... Ks>
+    static void _Diff(const T& a, const T& b, DiffContext& context, std::index_sequence<Ks...>) {
+        (_DiffField<Ks>(a, b, context), ...);
+    }
+};
+
+template <class _Ty, class _Dx>
+class Type<ISerialization, std::unique_ptr<_Ty, _Dx>, std::enable_if_t<std::is_base_of_v<ISerialization, _Ty> && SubclassInfo<_Ty>::has>>
+    : public TypeBase<ISerialization, std::unique_ptr<_Ty, _Dx>> {
+public:
+    using ValueType = std::unique_ptr<_Ty, _Dx>;
+    static constexpr auto kTypeKey = "type";
+    static constexpr auto kDataKey = "data";
+
+    void Serialize(const void* addr, ISerializationWriter& writer) const override {
+        const auto& v = *static_cast<const ValueType*>(addr);
+        if (v) {
+            writer.StartObject();
+            writer.String(kTypeKey);
+            auto entry = SubclassInfo<_Ty>::GetFactoryTable().FindByType(typeid(*v));
+            R_ASSERT(entry != nullptr);
+            writer.Uint(entry->id);
+            writer.String(kDataKey);
+            Type<ISerialization, _Ty>::GetIType()->Serialize(v.get(), writer);
+            writer.EndObject();
+        } else {
+            writer.Null();
+        }
+    }
+
+    void Deserialize(void* addr, const rapidjson::Value& value, DeserializeContext& context) const override {
+        R_DESERIALIZE_EXPECT(context, value.IsObject() || value.IsNull(), DeserializeError::TypeMismatch);
+        auto& v = *static_cast<ValueType*>(addr);
+        if (value.IsObject()) {
+            auto typeitr = value.FindMember(kTypeKey);
+            R_DESERIALIZE_EXPECT(context, typeitr != value.MemberEnd(), DeserializeError::MissingMember);
+            const auto& type = typeitr->value;
+            const auto& table = SubclassInfo<_Ty>::GetFactoryTable();
+            const typename SubclassInfo<_Ty>::FactoryTable::Entry* entry = nullptr;
+            if (type.IsUint())
+                entry = table.FindById(type.GetUint());
+            else if (type.IsString())
+                entry = table.FindByName(std::string_view(type.GetString(), type.GetStringLength()));
+            R_DESERIALIZE_EXPECT(context, entry != nullptr, DeserializeError::UnknownName);
+            _Reset(v, entry, context);
+
+            auto dataitr = value.FindMember(kDataKey);
+            R_DESERIALIZE_EXPECT(context, dataitr != value.MemberEnd(), DeserializeError::MissingMember);
+            Type<ISerialization, _Ty>::GetIType()->Deserialize(v.get(), dataitr->value, context);
+            _DeserializeFailed(context, kDataKey);
+        } else {
+            v.reset();
+        }
+    }
+
+    // Data before the type is read into a Document first, which is only created then
+    void Read(void* addr, ISerializationReader& reader, DeserializeContext& context) const override {
+        auto& v = *static_cast<ValueType*>(addr);
+        if (reader.GetToken() == ISerializationReader::Token::Value && reader.GetValue().IsNull()) {
+            v.reset();
+            return;
+        }
+        R_DESERIALIZE_EXPECT(context, reader.GetToken() == ISerializationReader::Token::StartObject, DeserializeError::TypeMismatch);
+        const typename SubclassInfo<_Ty>::FactoryTable::Entry* entry = nullptr;
+        bool has_data = false;
+        std::optional<rapidjson::Document> data;
+        for (reader.Next(); reader.GetToken() != ISerializationReader::Token::EndObject; reader.Next()) {
+            const auto key = reader.GetString();
+            const bool is_type = entry == nullptr && key == kTypeKey;
+            const bool is_data = !has_data && key == kDataKey;
+            reader.Next();
+            if (is_type) {
+                const auto& type = reader.GetValue();
+                const auto& table = SubclassInfo<_Ty>::GetFactoryTable();
+                if (reader.GetToken() == ISerializationReader::Token::Value && type.IsUint())
+                    entry = table.FindById(type.GetUint());
+                else if (reader.GetToken() == ISerializationReader::Token::Value && type.IsString())
+                    entry = table.FindByName(std::string_view(type.GetString(), type.GetStringLength()));
+                R_DESERIALIZE_EXPECT(context, entry != nullptr, DeserializeError::UnknownName);
+                _Reset(v, entry, context);
+            } else if (is_data) {
+                has_data = true;
+                if (entry != nullptr) {
+                    Type<ISerialization, _Ty>::GetIType()->Read(v.get(), reader, context);
+                    if (_DeserializeFailed(context, kDataKey))
+                        return;
+                } else {
+                    reader.Read(data.emplace());
+                }
+            } else {
+                reader.Skip();
+            }
+        }
+        R_DESERIALIZE_EXPECT(context, entry != nullptr && has_data, DeserializeError::MissingMember);
+        if (data) {
+            Type<ISerialization, _Ty>::GetIType()->Deserialize(v.get(), *data, context);
+            _DeserializeFailed(context, kDataKey);
+        }
+    }
+
+    // Objects of another subclass are set as a whole
+    void Diff(const void* a, const void* b, DiffContext& context) const override {
+        const auto& va = *static_cast<const ValueType*>(a);
+        const auto& vb = *static_cast<const ValueType*>(b);
+        if (va && vb && typeid(*va) == typeid(*vb))
+            Type<ISerialization, _Ty>::GetIType()->Diff(va.get(), vb.get(), context);
+        else
+            context.Set(b, this);
+    }
+
+    void WriteBinary(const void* addr, BinaryWriter& writer) const override {
+        const auto& v = *static_cast<const ValueType*>(addr);
+        if (v) {
+            auto entry = SubclassInfo<_Ty>::GetFactoryTable().FindByType(typeid(*v));
+            R_ASSERT(entry != nullptr);
+            writer.StartTyped(entry->id);
+            Type<ISerialization, _Ty>::GetIType()->WriteBinary(v.get(), writer);
+        } else {
+            writer.WriteNull();
         }
-        writer.EndObject();
     }
 
-    void Deserialize(void* addr, const rapidjson::Value& value) const override {
-        R_ASSERT(value.IsObject());
+    void ReadBinary(void* addr, BinaryReader& reader, DeserializeContext& context) const override {
         auto& v = *static_cast<ValueType*>(addr);
-        for (const auto& [name, fun] : GetFieldTable(v, static_cast<ISerialization*>(nullptr))) {
-            auto itr = value.FindMember(name.c_str());
-            if (itr != value.MemberEnd()) {
-                auto info = fun(&v);
-                info.type->Deserialize(info.address, itr->value);
-            } else {
-                FIELD_NOT_FOUND_HANDLE("Field \"" + name + "\" not found");
-            }
+        const auto tag = reader.ReadTag();
+        if (tag == BinaryTag::Null) {
+            v.reset();
+            return;
         }
+        R_DESERIALIZE_EXPECT(context, tag == BinaryTag::Typed, DeserializeError::TypeMismatch);
+        auto entry = SubclassInfo<_Ty>::GetFactoryTable().FindById(reader.ReadTypeId());
+        R_DESERIALIZE_EXPECT(context, entry != nullptr, DeserializeError::UnknownName);
+        _Reset(v, entry, context);
+        Type<ISerialization, _Ty>::GetIType()->ReadBinary(v.get(), reader, context);
+        _DeserializeFailed(context, kDataKey);
+    }
+
+    void WriteArchive(const void* addr, ArchiveWriter& writer, size_t slot) const override {
+        const auto& v = *static_cast<const ValueType*>(addr);
+        if (!v)
+            return;
+        auto entry = SubclassInfo<_Ty>::GetFactoryTable().FindByType(typeid(*v));
+        R_ASSERT(entry != nullptr);
+        const auto record = writer.Allocate(16);
+        const uint32_t id = entry->id;
+        writer.Store(record, &id, 4);
+        writer.Link(slot, record);
+        Type<ISerialization, _Ty>::GetIType()->WriteArchive(v.get(), writer, record + 8);
+    }
+
+private:
+    // In place, an object of the type of entry is kept
+    static void _Reset(ValueType& v, const typename SubclassInfo<_Ty>::FactoryTable::Entry* entry, DeserializeContext& context) {
+        if (context.in_place && v != nullptr && typeid(*v) == entry->type())
+            return;
+        const auto resource = ResourceForDeleter<_Dx>(context.resource);
+        ResetUniquePtr(v, entry->factory(_AllocatorFor(context, resource)), resource, entry->size, entry->alignment);
     }
 };
 
 template <class _Ty, class _Dx>
-class Type<ISerialization, std::unique_ptr<_Ty, _Dx>, std::enable_if_t<std::is_base_of_v<ISerialization, _Ty> && SubclassInfo<_Ty>::has>>
+class Type<ISerialization, std::unique_ptr<_Ty, _Dx>, std::enable_if_t<!(std::is_base_of_v<ISerialization, _Ty> && SubclassInfo<_Ty>::has)>>
     : public TypeBase<ISerialization, std::unique_ptr<_Ty, _Dx>> {
 public:
     using ValueType = std::unique_ptr<_Ty, _Dx>;
-    static constexpr auto kTypeKey = "type";
-    static constexpr auto kDataKey = "data";
 
-    void Serialize(const void* addr, rapidjson::PrettyWriter<rapidjson::StringBuffer>& writer) const override {
+    void Serialize(const void* addr, ISerializationWriter& writer) const override {
         const auto& v = *static_cast<const ValueType*>(addr);
-        if (v) {
-            writer.StartObject();
-            writer.String(kTypeKey);
-            writer.String(typeid(*v).name());
-            writer.String(kDataKey);
-            Type<ISerialization, _Ty>::GetIType()->Serialize(v.get(), writer);
-            writer.EndObject();
-        } else {
+        if (v)
+            reflection::Serialize(*v, writer);
+        else
             writer.Null();
-        }
     }
 
-    void Deserialize(void* addr, const rapidjson::Value& value) const override {
-        R_ASSERT(value.IsObject() || value.IsNull());
+    void Deserialize(void* addr, const rapidjson::Value& value, DeserializeContext& context) const override {
         auto& v = *static_cast<ValueType*>(addr);
-        if (value.IsObject()) {
-            auto typeitr = value.FindMember(kTypeKey);
-            R_ASSERT(typeitr != value.MemberEnd());
-            auto& name = typeitr->value;
-            R_ASSERT(name.IsString());
-            v.reset(SubclassInfo<_Ty>::GetFactoryTable().at(name.GetString())());
+        if (value.IsNull()) {
+            v.reset();
+        } else {
+            if (v == nullptr) {
+                const auto resource = ResourceForDeleter<_Dx>(context.resource);
+                ResetUniquePtr(v, CreateObject<_Ty>(_AllocatorFor(context, resource)), resource, sizeof(_Ty), alignof(_Ty));
+            }
+            reflection::Deserialize(*v, value, context);
+        }
+    }
 
-            auto dataitr = value.FindMember(kDataKey);
-            R_ASSERT(dataitr != value.MemberEnd());
-            Type<ISerialization, _Ty>::GetIType()->Deserialize(v.get(), dataitr->value);
+    void Read(void* addr, ISerializationReader& reader, DeserializeContext& context) const override {
+        auto& v = *static_cast<ValueType*>(addr);
+        if (reader.GetToken() == ISerializationReader::Token::Value && reader.GetValue().IsNull()) {
+            v.reset();
+        } else {
+            if (v == nullptr) {
+                const auto resource = ResourceForDeleter<_Dx>(context.resource);
+                ResetUniquePtr(v, CreateObject<_Ty>(_AllocatorFor(context, resource)), resource, sizeof(_Ty), alignof(_Ty));
+            }
+            reflection::Deserialize(*v, reader, context);
         }
     }
-};
 
-template <class _Ty, class _Dx>
-class Type<ISerialization, std::unique_ptr<_Ty, _Dx>, std::enable_if_t<!(std::is_base_of_v<ISerialization, _Ty> && SubclassInfo<_Ty>::has)>>
-    : public TypeBase<ISerialization, std::unique_ptr<_Ty, _Dx>> {
-public:
-    using ValueType = std::unique_ptr<_Ty, _Dx>;
+    void Diff(const void* a, const void* b, DiffContext& context) const override {
+        const auto& va = *static_cast<const ValueType*>(a);
+        const auto& vb = *static_cast<const ValueType*>(b);
+        if (va && vb)
+            reflection::Diff(*va, *vb, context);
+        else
+            context.Set(b, this);
+    }
 
-    void Serialize(const void* addr, rapidjson::PrettyWriter<rapidjson::StringBuffer>& writer) const override {
+    void WriteBinary(const void* addr, BinaryWriter& writer) const override {
         const auto& v = *static_cast<const ValueType*>(addr);
         if (v)
-            Type<ISerialization, _Ty>::GetIType()->Serialize(v.get(), writer);
+            reflection::SerializeBinary(*v, writer);
         else
-            writer.Null();
+            writer.WriteNull();
     }
 
-    void Deserialize(void* addr, const rapidjson::Value& value) const override {
+    void ReadBinary(void* addr, BinaryReader& reader, DeserializeContext& context) const override {
         auto& v = *static_cast<ValueType*>(addr);
-        if (value.IsNull()) {
+        if (reader.PeekTag() == BinaryTag::Null) {
+            reader.ReadTag();
             v.reset();
         } else {
-            if (v == nullptr)
-                v.reset(new _Ty());
-            Type<ISerialization, _Ty>::GetIType()->Deserialize(v.get(), value);
+            if (v == nullptr) {
+                const auto resource = ResourceForDeleter<_Dx>(context.resource);
+                ResetUniquePtr(v, CreateObject<_Ty>(_AllocatorFor(context, resource)), resource, sizeof(_Ty), alignof(_Ty));
+            }
+            reflection::DeserializeBinary(*v, reader, context);
         }
     }
+
+    void WriteArchive(const void* addr, ArchiveWriter& writer, size_t slot) const override {
+        const auto& v = *static_cast<const ValueType*>(addr);
+        if (!v)
+            return;
+        const auto record = writer.Allocate(8);
+        writer.Link(slot, record);
+        reflection::SerializeArchive(*v, writer, record);
+    }
 };
 
 template <class _Ty, size_t _Size>
 struct _SerializationArrayTypeHelper {
-    static void Serialize(const void* addr, rapidjson::PrettyWriter<rapidjson::StringBuffer>& writer) {
+    static void Serialize(const void* addr, ISerializationWriter& writer) {
         const auto arr = static_cast<const _Ty*>(addr);
         writer.StartArray();
         for (size_t i = 0; i < _Size; ++i) {
-            Type<ISerialization, _Ty>::GetIType()->Serialize(&arr[i], writer);
+            reflection::Serialize(arr[i], writer);
         }
         writer.EndArray();
     }
 
-    static void Deserialize(void* addr, const rapidjson::Value& value) {
-        R_ASSERT(value.IsArray());
-        R_ASSERT(value.Size() == _Size);
+    static void Deserialize(void* addr, const rapidjson::Value& value, DeserializeContext& context) {
+        R_DESERIALIZE_EXPECT(context, value.IsArray(), DeserializeError::TypeMismatch);
+        R_DESERIALIZE_EXPECT(context, value.Size() == _Size, DeserializeError::SizeMismatch);
+        auto arr = static_cast<_Ty*>(addr);
+        for (size_t i = 0; i < _Size; ++i) {
+            reflection::Deserialize(arr[i], value[static_cast<rapidjson::SizeType>(i)], context);
+            if (_DeserializeFailed(context, i))
+                return;
+        }
+    }
+
+    // Arrays of floating-point numbers are parsed in bulk where the reader can
+    static void Read(void* addr, ISerializationReader& reader, DeserializeContext& context) {
+        R_DESERIALIZE_EXPECT(context, reader.GetToken() == ISerializationReader::Token::StartArray, DeserializeError::TypeMismatch);
         auto arr = static_cast<_Ty*>(addr);
+        size_t i = 0;
+        if constexpr (std::is_same_v<_Ty, float> || std::is_same_v<_Ty, double>)
+            i = reader.ReadNumbers(arr, _Size);
+        for (; i < _Size; ++i) {
+            reader.Next();
+            R_DESERIALIZE_EXPECT(context, reader.GetToken() != ISerializationReader::Token::EndArray, DeserializeError::SizeMismatch);
+            reflection::Deserialize(arr[i], reader, context);
+            if (_DeserializeFailed(context, i))
+                return;
+        }
+        reader.Next();
+        R_DESERIALIZE_EXPECT(context, reader.GetToken() == ISerializationReader::Token::EndArray, DeserializeError::SizeMismatch);
+    }
+
+    static void Diff(const void* a, const void* b, DiffContext& context) {
+        const auto arr_a = static_cast<const _Ty*>(a);
+        const auto arr_b = static_cast<const _Ty*>(b);
         for (size_t i = 0; i < _Size; ++i) {
-            Type<ISerialization, _Ty>::GetIType()->Deserialize(&arr[i], value[static_cast<rapidjson::SizeType>(i)]);
+            if (Comparison<ISerialization, _Ty>::Equal(arr_a[i], arr_b[i]))
+                continue;
+            const auto size = context.PushIndex(i);
+            reflection::Diff(arr_a[i], arr_b[i], context);
+            context.Pop(size);
+        }
+    }
+
+    // Arrays of floating-point numbers are packed
+    static void WriteBinary(const void* addr, BinaryWriter& writer) {
+        const auto arr = static_cast<const _Ty*>(addr);
+        if constexpr (std::is_same_v<_Ty, float>) {
+            writer.WriteFloatArray(arr, _Size);
+        } else if constexpr (std::is_same_v<_Ty, double>) {
+            writer.WriteDoubleArray(arr, _Size);
+        } else {
+            writer.StartArray(_Size);
+            for (size_t i = 0; i < _Size; ++i)
+                reflection::SerializeBinary(arr[i], writer);
+        }
+    }
+
+    static void ReadBinary(void* addr, BinaryReader& reader, DeserializeContext& context) {
+        auto arr = static_cast<_Ty*>(addr);
+        if constexpr (std::is_floating_point_v<_Ty>) {
+            reader.ReadNumbers(arr, _Size);
+        } else {
+            reader.ExpectTag(BinaryTag::Array);
+            R_DESERIALIZE_EXPECT(context, reader.ReadCount() == _Size, DeserializeError::SizeMismatch);
+            for (size_t i = 0; i < _Size; ++i) {
+                reflection::DeserializeBinary(arr[i], reader, context);
+                if (_DeserializeFailed(context, i))
+                    return;
+            }
+        }
+    }
+
+    static void WriteArchive(const void* addr, ArchiveWriter& writer, size_t slot) {
+        const auto arr = static_cast<const _Ty*>(addr);
+        if constexpr (IsBitwiseComparable<ISerialization, _Ty>()) {
+            const auto record = writer.Allocate(sizeof(_Ty) * _Size);
+            writer.Store(record, arr, sizeof(_Ty) * _Size);
+            writer.Link(slot, record);
+        } else {
+            const auto record = writer.Allocate(8 * _Size);
+            writer.Link(slot, record);
+            for (size_t i = 0; i < _Size; ++i)
+                reflection::SerializeArchive(arr[i], writer, record + 8 * i);
         }
     }
 };
@@ -258,12 +2262,32 @@ template <class _Ty, size_t _Size>
 class Type<ISerialization, _Ty[_Size]>
     : public TypeBase<ISerialization, _Ty[_Size]> {
 public:
-    void Serialize(const void* addr, rapidjson::PrettyWriter<rapidjson::StringBuffer>& writer) const override {
+    void Serialize(const void* addr, ISerializationWriter& writer) const override {
         _SerializationArrayTypeHelper<_Ty, _Size>::Serialize(addr, writer);
     }
 
-    void Deserialize(void* addr, const rapidjson::Value& value) const override {
-        _SerializationArrayTypeHelper<_Ty, _Size>::Deserialize(addr, value);
+    void Deserialize(void* addr, const rapidjson::Value& value, DeserializeContext& context) const override {
+        _SerializationArrayTypeHelper<_Ty, _Size>::Deserialize(addr, value, context);
+    }
+
+    void Read(void* addr, ISerializationReader& reader, DeserializeContext& context) const override {
+        _SerializationArrayTypeHelper<_Ty, _Size>::Read(addr, reader, context);
+    }
+
+    void Diff(const void* a, const void* b, DiffContext& context) const override {
+        _SerializationArrayTypeHelper<_Ty, _Size>::Diff(a, b, context);
+    }
+
+    void WriteBinary(const void* addr, BinaryWriter& writer) const override {
+        _SerializationArrayTypeHelper<_Ty, _Size>::WriteBinary(addr, writer);
+    }
+
+    void ReadBinary(void* addr, BinaryReader& reader, DeserializeContext& context) const override {
+        _SerializationArrayTypeHelper<_Ty, _Size>::ReadBinary(addr, reader, context);
+    }
+
+    void WriteArchive(const void* addr, ArchiveWriter& writer, size_t slot) const override {
+        _SerializationArrayTypeHelper<_Ty, _Size>::WriteArchive(addr, writer, slot);
     }
 };
 
@@ -271,12 +2295,32 @@ template <class _Ty, size_t _Size>
 class Type<ISerialization, std::array<_Ty, _Size>>
     : public TypeBase<ISerialization, std::array<_Ty, _Size>> {
 public:
-    void Serialize(const void* addr, rapidjson::PrettyWriter<rapidjson::StringBuffer>& writer) const override {
+    void Serialize(const void* addr, ISerializationWriter& writer) const override {
         _SerializationArrayTypeHelper<_Ty, _Size>::Serialize(addr, writer);
     }
 
-    void Deserialize(void* addr, const rapidjson::Value& value) const override {
-        _SerializationArrayTypeHelper<_Ty, _Size>::Deserialize(addr, value);
+    void Deserialize(void* addr, const rapidjson::Value& value, DeserializeContext& context) const override {
+        _SerializationArrayTypeHelper<_Ty, _Size>::Deserialize(addr, value, context);
+    }
+
+    void Read(void* addr, ISerializationReader& reader, DeserializeContext& context) const override {
+        _SerializationArrayTypeHelper<_Ty, _Size>::Read(addr, reader, context);
+    }
+
+    void Diff(const void* a, const void* b, DiffContext& context) const override {
+        _SerializationArrayTypeHelper<_Ty, _Size>::Diff(a, b, context);
+    }
+
+    void WriteBinary(const void* addr, BinaryWriter& writer) const override {
+        _SerializationArrayTypeHelper<_Ty, _Size>::WriteBinary(addr, writer);
+    }
+
+    void ReadBinary(void* addr, BinaryReader& reader, DeserializeContext& context) const override {
+        _SerializationArrayTypeHelper<_Ty, _Size>::ReadBinary(addr, reader, context);
+    }
+
+    void WriteArchive(const void* addr, ArchiveWriter& writer, size_t slot) const override {
+        _SerializationArrayTypeHelper<_Ty, _Size>::WriteArchive(addr, writer, slot);
     }
 };
 
@@ -286,53 +2330,440 @@ class Type<ISerialization, ContainerType<_Ty, _Alloc>, std::enable_if_t<std::is_
 public:
     using ValueType = ContainerType<_Ty, _Alloc>;
 
-    void Serialize(const void* addr, rapidjson::PrettyWriter<rapidjson::StringBuffer>& writer) const override {
+    void Serialize(const void* addr, ISerializationWriter& writer) const override {
         const auto& v = *static_cast<const ValueType*>(addr);
         writer.StartArray();
-        for (const auto& e : v) {
-            Type<ISerialization, _Ty>::GetIType()->Serialize(&e, writer);
+        if (writer.IsParallel(v.size())) {
+            _WriteElements(v, writer);
+        } else {
+            for (const auto& e : v) {
+                reflection::Serialize(e, writer);
+            }
         }
         writer.EndArray();
     }
 
-    void Deserialize(void* addr, const rapidjson::Value& value) const override {
-        R_ASSERT(value.IsArray());
+    void Deserialize(void* addr, const rapidjson::Value& value, DeserializeContext& context) const override {
+        R_DESERIALIZE_EXPECT(context, value.IsArray(), DeserializeError::TypeMismatch);
         auto& v = *static_cast<ValueType*>(addr);
 
+        if constexpr (!std::is_same_v<_Ty, bool>) {
+            if (context.in_place || _IsParallel(context, value.Size())) {
+                if (!context.in_place)
+                    v.clear();
+                _DeserializeElements(v, value, context);
+                return;
+            }
+        }
         v.clear();
+        if constexpr (kIsVector)
+            v.reserve(value.Size());
         for (const auto& e : value.GetArray()) {
             _Ty tmp{};
-            Type<ISerialization, _Ty>::GetIType()->Deserialize(&tmp, e);
+            reflection::Deserialize(tmp, e, context);
+            if (_DeserializeFailed(context, v.size()))
+                return;
+            v.emplace_back(std::move(tmp));
+        }
+    }
+
+    void Read(void* addr, ISerializationReader& reader, DeserializeContext& context) const override {
+        R_DESERIALIZE_EXPECT(context, reader.GetToken() == ISerializationReader::Token::StartArray, DeserializeError::TypeMismatch);
+        auto& v = *static_cast<ValueType*>(addr);
+
+        // Numbers have no memory of their own to reuse
+        if constexpr (!std::is_arithmetic_v<_Ty>) {
+            if (context.in_place) {
+                _ReadInPlace(v, reader, context);
+                return;
+            }
+        }
+        v.clear();
+        if constexpr (std::is_same_v<_Ty, float> || std::is_same_v<_Ty, double>) {
+            _Ty numbers[kReadChunk];
+            for (size_t count = kReadChunk; count == kReadChunk;) {
+                count = reader.ReadNumbers(numbers, kReadChunk);
+                v.insert(v.end(), numbers, numbers + count);
+            }
+        }
+        for (reader.Next(); reader.GetToken() != ISerializationReader::Token::EndArray; reader.Next()) {
+            _Ty tmp{};
+            reflection::Deserialize(tmp, reader, context);
+            if (_DeserializeFailed(context, v.size()))
+                return;
             v.emplace_back(std::move(tmp));
         }
     }
+
+    // Elements are edited by index, elements past the end of a are set as a whole
+    void Diff(const void* a, const void* b, DiffContext& context) const override {
+        const auto& va = *static_cast<const ValueType*>(a);
+        const auto& vb = *static_cast<const ValueType*>(b);
+        if (va.size() != vb.size())
+            context.Resize(vb.size());
+        auto itr_a = va.begin();
+        auto itr_b = vb.begin();
+        for (size_t i = 0; itr_b != vb.end(); ++i, ++itr_b) {
+            const bool added = itr_a == va.end();
+            if (!added && Comparison<ISerialization, _Ty>::Equal(*itr_a, *itr_b)) {
+                ++itr_a;
+                continue;
+            }
+            const auto size = context.PushIndex(i);
+            if (added) {
+                context.Set(&*itr_b, Type<ISerialization, _Ty>::GetIType());
+            } else {
+                reflection::Diff(*itr_a, *itr_b, context);
+                ++itr_a;
+            }
+            context.Pop(size);
+        }
+    }
+
+    // Vectors of floating-point numbers are packed. In raw mode, vectors of raw serializable
+    // structs are written with one copy.
+    void WriteBinary(const void* addr, BinaryWriter& writer) const override {
+        const auto& v = *static_cast<const ValueType*>(addr);
+        if constexpr (std::is_same_v<ValueType, std::vector<float, _Alloc>>) {
+            writer.WriteFloatArray(v.data(), v.size());
+        } else if constexpr (std::is_same_v<ValueType, std::vector<double, _Alloc>>) {
+            writer.WriteDoubleArray(v.data(), v.size());
+        } else if (kRawElements && writer.IsRaw()) {
+            if constexpr (kRawElements)
+                writer.WriteRaw(GetRawLayout<ISerialization, _Ty>(), v.data(), v.size());
+        } else {
+            writer.StartArray(v.size());
+            for (const auto& e : v)
+                reflection::SerializeBinary(e, writer);
+        }
+    }
+
+    void ReadBinary(void* addr, BinaryReader& reader, DeserializeContext& context) const override {
+        auto& v = *static_cast<ValueType*>(addr);
+        if constexpr (kRawElements) {
+            if (reader.PeekTag() == BinaryTag::Raw) {
+                _ReadRawBinary<_Ty>(reader, context, 0, [&v](size_t count) {
+                    v.resize(count);
+                    return v.data();
+                });
+                return;
+            }
+        }
+        const auto tag = reader.ReadTag();
+        const auto count = reader.ReadCount();
+        if constexpr (std::is_same_v<ValueType, std::vector<_Ty, _Alloc>> && std::is_floating_point_v<_Ty>) {
+            v.resize(count);
+            reader.ReadNumbersValue(tag, v.data(), count);
+        } else {
+            R_DESERIALIZE_EXPECT(context, tag == BinaryTag::Array, DeserializeError::TypeMismatch);
+            if constexpr (!std::is_arithmetic_v<_Ty>) {
+                if (context.in_place) {
+                    v.resize(count);
+                    size_t i = 0;
+                    for (auto& e : v) {
+                        reflection::DeserializeBinary(e, reader, context);
+                        if (_DeserializeFailed(context, i++))
+                            return;
+                    }
+                    return;
+                }
+            }
+            v.clear();
+            if constexpr (std::is_same_v<ValueType, std::vector<_Ty, _Alloc>>)
+                v.reserve(count);
+            for (size_t i = 0; i < count; ++i) {
+                _Ty tmp{};
+                reflection::DeserializeBinary(tmp, reader, context);
+                if (_DeserializeFailed(context, i))
+                    return;
+                v.emplace_back(std::move(tmp));
+            }
+        }
+    }
+
+    // Bitwise comparable elements are stored as their images
+    void WriteArchive(const void* addr, ArchiveWriter& writer, size_t slot) const override {
+        const auto& v = *static_cast<const ValueType*>(addr);
+        constexpr size_t stride = kImageElements ? sizeof(_Ty) : 8;
+        const uint64_t count = v.size();
+        const auto record = writer.Allocate(8 + stride * v.size());
+        writer.Store(record, &count, 8);
+        writer.Link(slot, record);
+        if constexpr (kImageElements && std::is_same_v<ValueType, std::vector<_Ty, _Alloc>> && !std::is_same_v<_Ty, bool>) {
+            writer.Store(record + 8, v.data(), sizeof(_Ty) * v.size());
+        } else {
+            auto position = record + 8;
+            for (const auto& e : v) {
+                if constexpr (kImageElements) {
+                    const _Ty value = e;
+                    writer.Store(position, &value, sizeof(_Ty));
+                } else {
+                    reflection::SerializeArchive(e, writer, position);
+                }
+                position += stride;
+            }
+        }
+    }
+
+private:
+    static constexpr bool kIsVector = std::is_same_v<ValueType, std::vector<_Ty, _Alloc>>;
+
+    // Elements past the existing ones are value-initialized, as they are one by one
+    static void _DeserializeElements(ValueType& v, const rapidjson::Value& value, DeserializeContext& context) {
+        v.resize(value.Size());
+        if (!_IsParallel(context, v.size())) {
+            size_t i = 0;
+            for (auto& e : v) {
+                reflection::Deserialize(e, value[static_cast<rapidjson::SizeType>(i)], context);
+                if (_DeserializeFailed(context, i++))
+                    return;
+            }
+            return;
+        }
+        if constexpr (kIsVector) {
+            _DeserializeInParallel(v.size(), context, [&](size_t i, DeserializeContext& chunk_context) {
+                reflection::Deserialize(v[i], value[static_cast<rapidjson::SizeType>(i)], chunk_context);
+            });
+        } else {
+            std::vector<_Ty*> elements;
+            elements.reserve(v.size());
+            for (auto& e : v)
+                elements.push_back(&e);
+            _DeserializeInParallel(elements.size(), context, [&](size_t i, DeserializeContext& chunk_context) {
+                reflection::Deserialize(*elements[i], value[static_cast<rapidjson::SizeType>(i)], chunk_context);
+            });
+        }
+    }
+
+    static void _ReadInPlace(ValueType& v, ISerializationReader& reader, DeserializeContext& context) {
+        size_t count = 0;
+        auto itr = v.begin();
+        for (reader.Next(); reader.GetToken() != ISerializationReader::Token::EndArray; reader.Next()) {
+            if (itr == v.end()) {
+                v.emplace_back();
+                itr = std::prev(v.end());
+            }
+            reflection::Deserialize(*itr++, reader, context);
+            if (_DeserializeFailed(context, count))
+                return;
+            ++count;
+        }
+        v.resize(count);
+    }
+
+    // Lists are indexed through pointers to their elements
+    static void _WriteElements(const ValueType& v, ISerializationWriter& writer) {
+        if constexpr (kIsVector) {
+            writer.WriteElements(v.size(), {}, [&](size_t i, ISerializationWriter& w) { reflection::Serialize(static_cast<const _Ty&>(v[i]), w); });
+        } else {
+            std::vector<const _Ty*> elements;
+            elements.reserve(v.size());
+            for (const auto& e : v)
+                elements.push_back(&e);
+            writer.WriteElements(elements.size(), {}, [&](size_t i, ISerializationWriter& w) { reflection::Serialize(*elements[i], w); });
+        }
+    }
+
+    // Numbers parsed in bulk at a time
+    static constexpr size_t kReadChunk = 256;
+    static constexpr bool kImageElements = IsBitwiseComparable<ISerialization, _Ty>();
+    static constexpr bool kRawElements = std::is_same_v<ValueType, std::vector<_Ty, _Alloc>> && HasFieldDeclarations<ISerialization, _Ty>::value &&
+                                         IsRawSerializable<ISerialization, _Ty>();
 };
 
 template <class T>
 struct _SerializationMapTypeHelper {
     using _Ty = typename T::mapped_type;
 
-    static void Serialize(const void* addr, rapidjson::PrettyWriter<rapidjson::StringBuffer>& writer) {
+    static void Serialize(const void* addr, ISerializationWriter& writer) {
         const auto& v = *static_cast<const T*>(addr);
         writer.StartObject();
-        for (const auto& [key, value] : v) {
-            writer.String(key.c_str());
-            Type<ISerialization, _Ty>::GetIType()->Serialize(&value, writer);
+        if (writer.IsParallel(v.size())) {
+            std::vector<const typename T::value_type*> elements;
+            elements.reserve(v.size());
+            for (const auto& e : v)
+                elements.push_back(&e);
+            writer.WriteElements(
+                elements.size(), [&](size_t i) { return std::string_view(elements[i]->first.data(), elements[i]->first.size()); },
+                [&](size_t i, ISerializationWriter& w) { reflection::Serialize(elements[i]->second, w); });
+        } else {
+            for (const auto& [key, value] : v) {
+                writer.String(key.data(), static_cast<rapidjson::SizeType>(key.size()));
+                reflection::Serialize(value, writer);
+            }
         }
         writer.EndObject();
     }
 
-    static void Deserialize(void* addr, const rapidjson::Value& value) {
-        R_ASSERT(value.IsObject());
+    // In parallel, values are deserialized first and inserted afterwards in order
+    static void Deserialize(void* addr, const rapidjson::Value& value, DeserializeContext& context) {
+        R_DESERIALIZE_EXPECT(context, value.IsObject(), DeserializeError::TypeMismatch);
         auto& v = *static_cast<T*>(addr);
 
+        if (context.in_place) {
+            _DeserializeInPlace(v, context, [&](auto&& visit) {
+                for (const auto& e : value.GetObject()) {
+                    const std::string_view name(e.name.GetString(), e.name.GetStringLength());
+                    if (!visit(name, [&](_Ty& target) { reflection::Deserialize(target, e.value, context); }, [] {}))
+                        return;
+                }
+            });
+            return;
+        }
         v.clear();
+        if (_IsParallel(context, value.MemberCount())) {
+            std::vector<_Ty> values(value.MemberCount());
+            const auto members = value.MemberBegin();
+            _DeserializeInParallel(values.size(), context, [&](size_t i, DeserializeContext& chunk_context) {
+                reflection::Deserialize(values[i], members[static_cast<std::ptrdiff_t>(i)].value, chunk_context);
+            });
+            for (size_t i = 0; i < values.size(); ++i)
+                v.emplace(members[static_cast<std::ptrdiff_t>(i)].name.GetString(), std::move(values[i]));
+            return;
+        }
         for (const auto& e : value.GetObject()) {
             _Ty tmp{};
-            Type<ISerialization, _Ty>::GetIType()->Deserialize(&tmp, e.value);
+            reflection::Deserialize(tmp, e.value, context);
+            if (_DeserializeFailed(context, std::string_view(e.name.GetString(), e.name.GetStringLength())))
+                return;
             v.emplace(e.name.GetString(), std::move(tmp));
         }
     }
+
+    static void Read(void* addr, ISerializationReader& reader, DeserializeContext& context) {
+        R_DESERIALIZE_EXPECT(context, reader.GetToken() == ISerializationReader::Token::StartObject, DeserializeError::TypeMismatch);
+        auto& v = *static_cast<T*>(addr);
+
+        if (context.in_place) {
+            _DeserializeInPlace(v, context, [&](auto&& visit) {
+                for (reader.Next(); reader.GetToken() != ISerializationReader::Token::EndObject; reader.Next()) {
+                    const bool read = visit(
+                        reader.GetString(),
+                        [&](_Ty& target) {
+                            reader.Next();
+                            reflection::Deserialize(target, reader, context);
+                        },
+                        [&] {
+                            reader.Next();
+                            reader.Skip();
+                        });
+                    if (!read)
+                        return;
+                }
+            });
+            return;
+        }
+        v.clear();
+        for (reader.Next(); reader.GetToken() != ISerializationReader::Token::EndObject; reader.Next()) {
+            std::string key(reader.GetString());
+            reader.Next();
+            _Ty tmp{};
+            reflection::Deserialize(tmp, reader, context);
+            if (_DeserializeFailed(context, key))
+                return;
+            v.emplace(std::move(key), std::move(tmp));
+        }
+    }
+
+    static void Diff(const void* a, const void* b, DiffContext& context) {
+        const auto& va = *static_cast<const T*>(a);
+        const auto& vb = *static_cast<const T*>(b);
+        for (const auto& [key, value] : va) {
+            if (vb.find(key) == vb.end())
+                context.Erase(key);
+        }
+        for (const auto& [key, value] : vb) {
+            const auto itr = va.find(key);
+            if (itr != va.end() && Comparison<ISerialization, _Ty>::Equal(itr->second, value))
+                continue;
+            if (itr == va.end() || key.find(']') != std::string::npos) {
+                context.SetElement(key, &value, Type<ISerialization, _Ty>::GetIType());
+            } else {
+                const auto size = context.PushKey(key);
+                reflection::Diff(itr->second, value, context);
+                context.Pop(size);
+            }
+        }
+    }
+
+    static void WriteBinary(const void* addr, BinaryWriter& writer) {
+        const auto& v = *static_cast<const T*>(addr);
+        writer.StartMap(v.size());
+        for (const auto& [key, value] : v) {
+            writer.WriteMapKey(key);
+            reflection::SerializeBinary(value, writer);
+        }
+    }
+
+    static void ReadBinary(void* addr, BinaryReader& reader, DeserializeContext& context) {
+        reader.ExpectTag(BinaryTag::Map);
+        auto& v = *static_cast<T*>(addr);
+
+        if (context.in_place) {
+            _DeserializeInPlace(v, context, [&](auto&& visit) {
+                for (auto count = reader.ReadCount(); count > 0; --count) {
+                    if (!visit(
+                            reader.ReadStringValue(), [&](_Ty& target) { reflection::DeserializeBinary(target, reader, context); },
+                            [&] { reader.SkipValue(reader.ReadTag()); }))
+                        return;
+                }
+            });
+            return;
+        }
+        v.clear();
+        for (auto count = reader.ReadCount(); count > 0; --count) {
+            std::string key(reader.ReadStringValue());
+            _Ty tmp{};
+            reflection::DeserializeBinary(tmp, reader, context);
+            if (_DeserializeFailed(context, key))
+                return;
+            v.emplace(std::move(key), std::move(tmp));
+        }
+    }
+
+    static void WriteArchive(const void* addr, ArchiveWriter& writer, size_t slot) {
+        const auto& v = *static_cast<const T*>(addr);
+        std::vector<const typename T::value_type*> elements;
+        elements.reserve(v.size());
+        for (const auto& e : v)
+            elements.push_back(&e);
+        std::sort(elements.begin(), elements.end(), [](const auto a, const auto b) { return a->first < b->first; });
+        const uint64_t count = v.size();
+        const auto record = writer.Allocate(8 + 16 * v.size());
+        writer.Store(record, &count, 8);
+        writer.Link(slot, record);
+        for (size_t i = 0; i < elements.size(); ++i) {
+            const auto entry = record + 8 + 16 * i;
+            writer.Link(entry, writer.WriteString(elements[i]->first));
+            reflection::SerializeArchive(elements[i]->second, writer, entry + 8);
+        }
+    }
+
+private:
+    // for_each_member(visit) calls visit(key, read, skip) for each member, where read(value)
+    // reads its value and skip() passes over it, and stops if visit returns false as the value
+    // failed. Values are read over those of existing keys, and keys that were not read are
+    // erased. Of members with duplicated keys the first is read, as by Deserialize.
+    template <class ForEachMember>
+    static void _DeserializeInPlace(T& v, DeserializeContext& context, ForEachMember&& for_each_member) {
+        _SerializationKeySet read_keys(context.keys);
+        for_each_member([&](std::string_view name, auto&& read, auto&& skip) {
+            context.key.assign(name.data(), name.size());
+            auto itr = v.find(context.key);
+            if (itr == v.end())
+                itr = v.emplace(context.key, _Ty{}).first;
+            if (!read_keys.Insert(&itr->first)) {
+                skip();
+                return true;
+            }
+            read(itr->second);
+            return !_DeserializeFailed(context, itr->first);
+        });
+        if (read_keys.size() != v.size()) {
+            for (auto itr = v.begin(); itr != v.end();)
+                itr = read_keys.Contains(&itr->first) ? std::next(itr) : v.erase(itr);
+        }
+    }
 };
 
 template <template <class _Kty, class _Ty, class _Pr, class _Alloc> class ContainerType,
@@ -342,12 +2773,32 @@ class Type<ISerialization, ContainerType<_Kty, _Ty, _Pr, _Alloc>, std::enable_if
 public:
     using ValueType = ContainerType<_Kty, _Ty, _Pr, _Alloc>;
 
-    void Serialize(const void* addr, rapidjson::PrettyWriter<rapidjson::StringBuffer>& writer) const override {
+    void Serialize(const void* addr, ISerializationWriter& writer) const override {
         _SerializationMapTypeHelper<ValueType>::Serialize(addr, writer);
     }
 
-    void Deserialize(void* addr, const rapidjson::Value& value) const override {
-        _SerializationMapTypeHelper<ValueType>::Deserialize(addr, value);
+    void Deserialize(void* addr, const rapidjson::Value& value, DeserializeContext& context) const override {
+        _SerializationMapTypeHelper<ValueType>::Deserialize(addr, value, context);
+    }
+
+    void Read(void* addr, ISerializationReader& reader, DeserializeContext& context) const override {
+        _SerializationMapTypeHelper<ValueType>::Read(addr, reader, context);
+    }
+
+    void Diff(const void* a, const void* b, DiffContext& context) const override {
+        _SerializationMapTypeHelper<ValueType>::Diff(a, b, context);
+    }
+
+    void WriteBinary(const void* addr, BinaryWriter& writer) const override {
+        _SerializationMapTypeHelper<ValueType>::WriteBinary(addr, writer);
+    }
+
+    void ReadBinary(void* addr, BinaryReader& reader, DeserializeContext& context) const override {
+        _SerializationMapTypeHelper<ValueType>::ReadBinary(addr, reader, context);
+    }
+
+    void WriteArchive(const void* addr, ArchiveWriter& writer, size_t slot) const override {
+        _SerializationMapTypeHelper<ValueType>::WriteArchive(addr, writer, slot);
     }
 };
 
@@ -358,12 +2809,136 @@ class Type<ISerialization, ContainerType<_Kty, _Ty, _Hasher, _Keyeq, _Alloc>, st
 public:
     using ValueType = ContainerType<_Kty, _Ty, _Hasher, _Keyeq, _Alloc>;
 
-    void Serialize(const void* addr, rapidjson::PrettyWriter<rapidjson::StringBuffer>& writer) const override {
+    void Serialize(const void* addr, ISerializationWriter& writer) const override {
         _SerializationMapTypeHelper<ValueType>::Serialize(addr, writer);
     }
 
-    void Deserialize(void* addr, const rapidjson::Value& value) const override {
-        _SerializationMapTypeHelper<ValueType>::Deserialize(addr, value);
+    void Deserialize(void* addr, const rapidjson::Value& value, DeserializeContext& context) const override {
+        _SerializationMapTypeHelper<ValueType>::Deserialize(addr, value, context);
+    }
+
+    void Read(void* addr, ISerializationReader& reader, DeserializeContext& context) const override {
+        _SerializationMapTypeHelper<ValueType>::Read(addr, reader, context);
+    }
+
+    void Diff(const void* a, const void* b, DiffContext& context) const override {
+        _SerializationMapTypeHelper<ValueType>::Diff(a, b, context);
+    }
+
+    void WriteBinary(const void* addr, BinaryWriter& writer) const override {
+        _SerializationMapTypeHelper<ValueType>::WriteBinary(addr, writer);
+    }
+
+    void ReadBinary(void* addr, BinaryReader& reader, DeserializeContext& context) const override {
+        _SerializationMapTypeHelper<ValueType>::ReadBinary(addr, reader, context);
+    }
+
+    void WriteArchive(const void* addr, ArchiveWriter& writer, size_t slot) const override {
+        _SerializationMapTypeHelper<ValueType>::WriteArchive(addr, writer, slot);
+    }
+};
+
+// Serialized the same as std::vector<T>
+template <class I, class T>
+class Type<ISerialization, SoaVector<I, T>> : public TypeBase<ISerialization, SoaVector<I, T>> {
+public:
+    using ValueType = SoaVector<I, T>;
+
+    void Serialize(const void* addr, ISerializationWriter& writer) const override {
+        const auto& v = *static_cast<const ValueType*>(addr);
+        writer.StartArray();
+        for (size_t i = 0; i < v.size(); ++i) {
+            if constexpr (std::is_same_v<I, ISerialization>) {
+                // Columns are the serialized fields, written from the columns in place
+                writer.StartObject();
+                v[i].ForEachField([&writer](std::string_view name, const auto& member) {
+                    writer.String(name.data(), static_cast<rapidjson::SizeType>(name.size()));
+                    reflection::Serialize(member, writer);
+                });
+                writer.EndObject();
+            } else {
+                reflection::Serialize(v.Load(i), writer);
+            }
+        }
+        writer.EndArray();
+    }
+
+    void Deserialize(void* addr, const rapidjson::Value& value, DeserializeContext& context) const override {
+        R_DESERIALIZE_EXPECT(context, value.IsArray(), DeserializeError::TypeMismatch);
+        auto& v = *static_cast<ValueType*>(addr);
+
+        v.clear();
+        v.reserve(value.Size());
+        for (const auto& e : value.GetArray()) {
+            T tmp{};
+            reflection::Deserialize(tmp, e, context);
+            if (_DeserializeFailed(context, v.size()))
+                return;
+            v.push_back(std::move(tmp));
+        }
+    }
+
+    void Read(void* addr, ISerializationReader& reader, DeserializeContext& context) const override {
+        R_DESERIALIZE_EXPECT(context, reader.GetToken() == ISerializationReader::Token::StartArray, DeserializeError::TypeMismatch);
+        auto& v = *static_cast<ValueType*>(addr);
+
+        v.clear();
+        for (reader.Next(); reader.GetToken() != ISerializationReader::Token::EndArray; reader.Next()) {
+            T tmp{};
+            reflection::Deserialize(tmp, reader, context);
+            if (_DeserializeFailed(context, v.size()))
+                return;
+            v.push_back(std::move(tmp));
+        }
+    }
+
+    void WriteBinary(const void* addr, BinaryWriter& writer) const override {
+        const auto& v = *static_cast<const ValueType*>(addr);
+        writer.StartArray(v.size());
+        for (size_t i = 0; i < v.size(); ++i) {
+            if constexpr (std::is_same_v<I, ISerialization>) {
+                const auto& fields = FieldTableOf<ISerialization, T>::fields;
+                writer.StartObject(fields.data(), fields.data() + fields.size());
+                v[i].ForEachField([&writer](std::string_view, const auto& member) {
+                    reflection::SerializeBinary(member, writer);
+                });
+            } else {
+                reflection::SerializeBinary(v.Load(i), writer);
+            }
+        }
+    }
+
+    void ReadBinary(void* addr, BinaryReader& reader, DeserializeContext& context) const override {
+        reader.ExpectTag(BinaryTag::Array);
+        auto& v = *static_cast<ValueType*>(addr);
+
+        const auto count = reader.ReadCount();
+        v.clear();
+        v.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            T tmp{};
+            reflection::DeserializeBinary(tmp, reader, context);
+            if (_DeserializeFailed(context, i))
+                return;
+            v.push_back(std::move(tmp));
+        }
+    }
+
+    void WriteArchive(const void* addr, ArchiveWriter& writer, size_t slot) const override {
+        const auto& v = *static_cast<const ValueType*>(addr);
+        const uint64_t count = v.size();
+        const auto record = writer.Allocate(8 + 8 * v.size());
+        writer.Store(record, &count, 8);
+        writer.Link(slot, record);
+        for (size_t i = 0; i < v.size(); ++i) {
+            if constexpr (std::is_same_v<I, ISerialization>) {
+                _WriteArchiveFields<T>(writer, record + 8 + 8 * i, [row = v[i]](auto&& write) {
+                    row.ForEachField([&write](std::string_view, const auto& member) { write(member); });
+                });
+            } else {
+                reflection::SerializeArchive(v.Load(i), writer, record + 8 + 8 * i);
+            }
+        }
     }
 };
 
@@ -2,6 +2,7 @@
 
 #include <glm/glm.hpp>
 
+#include "compare_ext_glm.h"
 #include "serialization.h"
 
 namespace reflection {
@@ -10,12 +11,28 @@ template <glm::length_t L, typename T, glm::qualifier Q>
 class Type<ISerialization, glm::vec<L, T, Q>>
     : public TypeBase<ISerialization, glm::vec<L, T, Q>> {
 public:
-    void Serialize(const void* addr, rapidjson::PrettyWriter<rapidjson::StringBuffer>& writer) const override {
+    void Serialize(const void* addr, ISerializationWriter& writer) const override {
         _SerializationArrayTypeHelper<T, L>::Serialize(addr, writer);
     }
 
-    void Deserialize(void* addr, const rapidjson::Value& value) const override {
-        _SerializationArrayTypeHelper<T, L>::Deserialize(addr, value);
+    void Deserialize(void* addr, const rapidjson::Value& value, DeserializeContext& context) const override {
+        _SerializationArrayTypeHelper<T, L>::Deserialize(addr, value, context);
+    }
+
+    void Read(void* addr, ISerializationReader& reader, DeserializeContext& context) const override {
+        _SerializationArrayTypeHelper<T, L>::Read(addr, reader, context);
+    }
+
+    void WriteBinary(const void* addr, BinaryWriter& writer) const override {
+        _SerializationArrayTypeHelper<T, L>::WriteBinary(addr, writer);
+    }
+
+    void ReadBinary(void* addr, BinaryReader& reader, DeserializeContext& context) const override {
+        _SerializationArrayTypeHelper<T, L>::ReadBinary(addr, reader, context);
+    }
+
+    void WriteArchive(const void* addr, ArchiveWriter& writer, size_t slot) const override {
+        _SerializationArrayTypeHelper<T, L>::WriteArchive(addr, writer, slot);
     }
 };
 
@@ -26,12 +43,28 @@ public:
     using ValueType = glm::mat<C, R, T, Q>;
     using LineT = typename ValueType::col_type;
 
-    void Serialize(const void* addr, rapidjson::PrettyWriter<rapidjson::StringBuffer>& writer) const override {
+    void Serialize(const void* addr, ISerializationWriter& writer) const override {
         _SerializationArrayTypeHelper<LineT, ValueType::length()>::Serialize(addr, writer);
     }
 
-    void Deserialize(void* addr, const rapidjson::Value& value) const override {
-        _SerializationArrayTypeHelper<LineT, ValueType::length()>::Deserialize(addr, value);
+    void Deserialize(void* addr, const rapidjson::Value& value, DeserializeContext& context) const override {
+        _SerializationArrayTypeHelper<LineT, ValueType::length()>::Deserialize(addr, value, context);
+    }
+
+    void Read(void* addr, ISerializationReader& reader, DeserializeContext& context) const override {
+        _SerializationArrayTypeHelper<LineT, ValueType::length()>::Read(addr, reader, context);
+    }
+
+    void WriteBinary(const void* addr, BinaryWriter& writer) const override {
+        _SerializationArrayTypeHelper<LineT, ValueType::length()>::WriteBinary(addr, writer);
+    }
+
+    void ReadBinary(void* addr, BinaryReader& reader, DeserializeContext& context) const override {
+        _SerializationArrayTypeHelper<LineT, ValueType::length()>::ReadBinary(addr, reader, context);
+    }
+
+    void WriteArchive(const void* addr, ArchiveWriter& writer, size_t slot) const override {
+        _SerializationArrayTypeHelper<LineT, ValueType::length()>::WriteArchive(addr, writer, slot);
     }
 };
 
@@ -0,0 +1,263 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "reflection.h"
+
+namespace reflection {
+
+// Allocates columns on cache line boundaries, for aligned vector loads
+template <class T>
+class _SoaColumnAllocator {
+public:
+    using value_type = T;
+    static constexpr size_t kAlignment = alignof(T) > 64 ? alignof(T) : 64;
+
+    _SoaColumnAllocator() = default;
+
+    template <class U>
+    constexpr _SoaColumnAllocator(const _SoaColumnAllocator<U>&) noexcept {
+    }
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(kAlignment)));
+    }
+
+    void deallocate(T* p, size_t) noexcept {
+        ::operator delete(p, std::align_val_t(kAlignment));
+    }
+
+    template <class U>
+    bool operator==(const _SoaColumnAllocator<U>&) const {
+        return true;
+    }
+
+    template <class U>
+    bool operator!=(const _SoaColumnAllocator<U>&) const {
+        return false;
+    }
+};
+
+// Column element. Wraps the field so that bool columns are not std::vector<bool>
+// and array fields can be stored in a vector.
+template <class M>
+struct _SoaCell {
+    M value;
+};
+
+template <class M>
+void _SoaCopy(M& dst, const M& src) {
+    if constexpr (std::is_array_v<M>) {
+        for (size_t i = 0; i < std::extent_v<M>; ++i)
+            _SoaCopy(dst[i], src[i]);
+    } else {
+        dst = src;
+    }
+}
+
+template <class M>
+void _SoaMove(M& dst, M& src) {
+    if constexpr (std::is_array_v<M>) {
+        for (size_t i = 0; i < std::extent_v<M>; ++i)
+            _SoaMove(dst[i], src[i]);
+    } else {
+        dst = std::move(src);
+    }
+}
+
+// Vector of T stored as one contiguous column per field of T declared for I, in name order.
+// Scans of a few fields touch only their columns, which are plain aligned arrays that
+// compilers can vectorize. Fields not declared for I are not stored: they are
+// value-initialized in the rows read back with Load.
+template <class I, class T>
+class SoaVector {
+    using Declarations = FieldDeclarationsOf<I, T>;
+
+    template <size_t K>
+    using _Declaration = std::tuple_element_t<Declarations::order[K], std::remove_const_t<decltype(Declarations::declarations)>>;
+
+public:
+    using value_type = T;
+
+    template <size_t K>
+    using ColumnType = typename _Declaration<K>::ValueType;
+
+    static constexpr size_t kColumnCount = Declarations::order.size();
+
+    static constexpr std::string_view ColumnName(size_t k) {
+        return Declarations::names[Declarations::order[k]];
+    }
+
+    // kColumnCount if no field has that name, for Column<ColumnIndex("name")>()
+    static constexpr size_t ColumnIndex(std::string_view name) {
+        for (size_t k = 0; k < kColumnCount; ++k)
+            if (ColumnName(k) == name)
+                return k;
+        return kColumnCount;
+    }
+
+    // Fields of one element, in place in the columns
+    template <class Vector>
+    class BasicRow {
+    public:
+        BasicRow(Vector& v, size_t i) : v(v), i(i) {
+        }
+
+        template <size_t K>
+        auto& Get() const {
+            return v.template Column<K>()[i];
+        }
+
+        T Load() const {
+            return v.Load(i);
+        }
+
+        // Calls f(name, member) for the fields of the row, like for_each_field
+        template <class F>
+        void ForEachField(F&& f) const {
+            v._ForEachColumn([&](auto k) {
+                f(ColumnName(k), Get<k>());
+            });
+        }
+
+    private:
+        Vector& v;
+        size_t i;
+    };
+
+    using Row = BasicRow<SoaVector>;
+    using ConstRow = BasicRow<const SoaVector>;
+
+    template <size_t K>
+    ColumnType<K>* Column() {
+        return reinterpret_cast<ColumnType<K>*>(std::get<K>(columns).data());
+    }
+
+    template <size_t K>
+    const ColumnType<K>* Column() const {
+        return reinterpret_cast<const ColumnType<K>*>(std::get<K>(columns).data());
+    }
+
+    Row operator[](size_t i) {
+        return Row(*this, i);
+    }
+
+    ConstRow operator[](size_t i) const {
+        return ConstRow(*this, i);
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    void clear() {
+        _ForEachColumn([this](auto k) { std::get<k>(columns).clear(); });
+        count = 0;
+    }
+
+    void reserve(size_t n) {
+        _ForEachColumn([this, n](auto k) { std::get<k>(columns).reserve(n); });
+    }
+
+    void resize(size_t n) {
+        _ForEachColumn([this, n](auto k) { std::get<k>(columns).resize(n); });
+        count = n;
+    }
+
+    void emplace_back() {
+        resize(count + 1);
+    }
+
+    void push_back(const T& row) {
+        emplace_back();
+        Store(count - 1, row);
+    }
+
+    void push_back(T&& row) {
+        emplace_back();
+        Store(count - 1, std::move(row));
+    }
+
+    void pop_back() {
+        _ForEachColumn([this](auto k) { std::get<k>(columns).pop_back(); });
+        --count;
+    }
+
+    T Load(size_t i) const {
+        T row{};
+        _ForEachColumn([&](auto k) {
+            _SoaCopy(_GetMember<k>(row), std::get<k>(columns)[i].value);
+        });
+        return row;
+    }
+
+    void Store(size_t i, const T& row) {
+        _ForEachColumn([&](auto k) {
+            _SoaCopy(std::get<k>(columns)[i].value, _GetMember<k>(row));
+        });
+    }
+
+    void Store(size_t i, T&& row) {
+        _ForEachColumn([&](auto k) {
+            _SoaMove(std::get<k>(columns)[i].value, _GetMember<k>(row));
+        });
+    }
+
+    void Swap(size_t i, size_t j) {
+        _ForEachColumn([&](auto k) {
+            auto& column = std::get<k>(columns);
+            std::swap(column[i], column[j]);
+        });
+    }
+
+private:
+    template <size_t K>
+    using _Column = std::vector<_SoaCell<ColumnType<K>>, _SoaColumnAllocator<_SoaCell<ColumnType<K>>>>;
+
+    template <size_t... Ks>
+    static auto _MakeColumns(std::index_sequence<Ks...>) -> std::tuple<_Column<Ks>...>;
+
+    template <size_t K, class Row>
+    static auto& _GetMember(Row& row) {
+        using Member = std::conditional_t<std::is_const_v<Row>, const ColumnType<K>, ColumnType<K>>;
+        const auto& declaration = std::get<Declarations::order[K]>(Declarations::declarations);
+        return *static_cast<Member*>(declaration.GetAddress(const_cast<std::remove_const_t<Row>*>(&row)));
+    }
+
+    template <class F, size_t... Ks>
+    static void _ForEachColumn(F& f, std::index_sequence<Ks...>) {
+        (f(std::integral_constant<size_t, Ks>()), ...);
+    }
+
+    template <class F>
+    void _ForEachColumn(F&& f) const {
+        _ForEachColumn(f, std::make_index_sequence<kColumnCount>());
+    }
+
+    template <size_t K>
+    static constexpr bool _IsPacked() {
+        return sizeof(_SoaCell<ColumnType<K>>) == sizeof(ColumnType<K>);
+    }
+
+    template <size_t... Ks>
+    static constexpr bool _IsPacked(std::index_sequence<Ks...>) {
+        return (_IsPacked<Ks>() && ...);
+    }
+
+    static_assert(_IsPacked(std::make_index_sequence<kColumnCount>()), "Column elements must be contiguous");
+
+    decltype(_MakeColumns(std::make_index_sequence<kColumnCount>())) columns;
+    size_t count = 0;
+};
+
+}  // namespace reflection
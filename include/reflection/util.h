@@ -6,7 +6,11 @@
 #include <stdexcept>
 
 #define R_ASSERT(exp) \
-    if (!(exp)) throw std::runtime_error(std::string("error at File: ") + __FILE__ + " Line: " + std::to_string(__LINE__) + " Statement: " + #exp);
+    if (!(exp)) R_FAIL(#exp);
+
+// Throws the error of R_ASSERT for statement, a string
+#define R_FAIL(statement) \
+    throw std::runtime_error(std::string("error at File: ") + __FILE__ + " Line: " + std::to_string(__LINE__) + " Statement: " + statement)
 
 template <class T>
 constexpr size_t MaxEnumStringViewSize() {